@@ -0,0 +1,148 @@
+// Throughput of BatchedAllocator against the number of producer threads. Each producer drives its own task:
+// it initiates every resource type, then requests a random amount of a random resource and releases it again,
+// and finally terminates. Reported per producer count: decisions per second, how many actions the core applied
+// per batch on average (what each tick's deadlock check, commit and blocked retry are amortized over), and ticks.
+// First, a deadlock between two tasks of an allocator sized for four has to be resolved although the other two
+// never send anything; if it isn't, that is reported and the exit status is 1.
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "batched_allocator.h"
+
+using namespace std;
+
+struct BenchOptions
+{
+	int resources, units, operations, max_producers, max_batch;
+};
+
+static void producer(BatchedAllocator &allocator, const BenchOptions &options, int task_id, atomic<bool> &go,
+		atomic<long long> &aborts)
+{
+	mt19937 random(task_id + 1);
+	while (!go.load())
+	{
+		this_thread::yield();
+	}
+	for (int r = 0; r < options.resources; r++)
+	{
+		allocator.initiate(task_id, r, options.units);
+	}
+	for (int i = 0; i < options.operations; i++)
+	{
+		int resource_id = random() % options.resources;
+		int amount = 1 + random() % options.units;
+		decision_t decision = allocator.request(task_id, resource_id, amount);
+		if (decision == DECISION_ABORTED)
+		{
+			aborts++;
+			return;
+		}
+		allocator.release(task_id, resource_id, amount);
+	}
+	allocator.terminate(task_id);
+}
+
+// Of 2 units, task 0 holds both and asks for 1 more while task 1 asks for 1. Only tasks 0 and 1 are used, so
+// they are every live task and FIFO aborts the lowest id, task 0, which grants task 1's request
+static bool checkUnusedTasks()
+{
+	BatchedAllocator allocator(4, vector<int>(1, 2));
+	atomic<int> first(-1), second(-1);
+	allocator.request(0, 0, 2);
+	thread waiter([&allocator, &second]() { second = allocator.request(1, 0, 1); });
+	thread holder([&allocator, &first]() { first = allocator.request(0, 0, 1); });
+
+	chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::seconds(5);
+	while ((first.load() < 0 || second.load() < 0) && chrono::steady_clock::now() < deadline)
+	{
+		this_thread::sleep_for(chrono::milliseconds(1));
+	}
+	if (first.load() < 0 || second.load() < 0)
+	{
+		// The blocked requests are never answered, so neither the threads nor the allocator can be waited for
+		cerr << "A deadlock between tasks 1 and 2 was not resolved while tasks 3 and 4 were unused\n";
+		_Exit(1);
+	}
+	holder.join();
+	waiter.join();
+	if (first.load() != DECISION_ABORTED || second.load() != DECISION_GRANTED)
+	{
+		cerr << "A deadlock between tasks 1 and 2 should abort task 1 and grant task 2\n";
+		return false;
+	}
+	allocator.terminate(1);
+	return true;
+}
+
+static void runProducers(const BenchOptions &options, int num_producers)
+{
+	atomic<long long> aborts(0);
+	atomic<bool> go(false);
+	double seconds;
+	long long messages, batches, ticks;
+	{
+		BatchedAllocator allocator(num_producers, vector<int>(options.resources, options.units), options.max_batch);
+		vector<thread> threads;
+		for (int t = 0; t < num_producers; t++)
+		{
+			threads.push_back(thread(producer, ref(allocator), cref(options), t, ref(go), ref(aborts)));
+		}
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		go = true;
+		for (unsigned int t = 0; t < threads.size(); t++)
+		{
+			threads[t].join();
+		}
+		seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		messages = allocator.getMessages();
+		batches = allocator.getBatches();
+		ticks = allocator.getTicks();
+	}
+	cout << num_producers << "\t" << messages << "\t" << fixed << setprecision(0) << messages / seconds << "\t"
+			<< setprecision(1) << (double)messages / max(1LL, batches) << "\t" << ticks << "\t" << aborts.load()
+			<< "\n";
+}
+
+int main(int argc, char** argv)
+{
+	BenchOptions options = { 16, 8, 20000, 64, DEFAULT_MAX_BATCH };
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (arg.compare(0, 12, "--resources=") == 0)
+			options.resources = max(1, atoi(arg.c_str() + 12));
+		else if (arg.compare(0, 8, "--units=") == 0)
+			options.units = max(1, atoi(arg.c_str() + 8));
+		else if (arg.compare(0, 13, "--operations=") == 0)
+			options.operations = max(1, atoi(arg.c_str() + 13));
+		else if (arg.compare(0, 16, "--max-producers=") == 0)
+			options.max_producers = max(1, atoi(arg.c_str() + 16));
+		else if (arg.compare(0, 12, "--max-batch=") == 0)
+			options.max_batch = max(1, atoi(arg.c_str() + 12));
+		else
+		{
+			cerr << "Usage: " << argv[0] << " [--resources=N] [--units=N] [--operations=N] [--max-producers=N]"
+					" [--max-batch=N]\n";
+			return 1;
+		}
+	}
+
+	if (!checkUnusedTasks())
+		return 1;
+	cout << options.resources << " resources of " << options.units << " units, " << options.operations
+			<< " request/release pairs per producer, batches of at most " << options.max_batch << "\n";
+	cout << "producers\tactions\tactions/s\tactions/batch\tticks\taborts\n";
+	for (int producers = 1; producers <= options.max_producers; producers *= 2)
+	{
+		runProducers(options, producers);
+	}
+	return 0;
+}
@@ -0,0 +1,161 @@
+// Scaling benchmark and stress check for ConcurrentResourceManager. Each thread drives its own task.
+//
+// The scaling run has every thread request a random amount of one random resource and release it again, so
+// nothing can deadlock, and reports decisions per second and how often a request had to park, at 1 to 64
+// threads. The stress run has every thread hold up to two resources at a time, taken in any order, so tasks
+// do deadlock and get aborted; an aborted task starts over. Every abort must be made while each live task is
+// inside request(), and when the threads are done, every task must have given back what it held, and held +
+// available must equal the units of every resource. A violation is reported and the exit status is 1.
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "concurrent_manager.h"
+#include "stress_state.h"
+
+using namespace std;
+
+struct BenchOptions
+{
+	int resources, units, operations, max_threads;
+	bool stress;
+};
+
+// Request, then release, one resource at a time
+static void scalingWorker(ConcurrentResourceManager &manager, const BenchOptions &options, int task_id,
+		atomic<bool> &go)
+{
+	mt19937 random(task_id + 1);
+	manager.start(task_id);
+	while (!go.load())
+	{
+		this_thread::yield();
+	}
+	for (int i = 0; i < options.operations; i++)
+	{
+		int resource_id = random() % options.resources;
+		int amount = 1 + random() % options.units;
+		if (manager.request(task_id, resource_id, amount) == DECISION_GRANTED)
+			manager.release(task_id, resource_id, amount);
+	}
+	manager.terminate(task_id);
+}
+
+// Hold up to two resources, taken in any order, so tasks deadlock; an aborted task starts over
+static void stressWorker(ConcurrentResourceManager &manager, const BenchOptions &options, int task_id,
+		atomic<bool> &go, StressState &state)
+{
+	mt19937 random(task_id + 1);
+	state.start(manager, task_id);
+	while (!go.load())
+	{
+		this_thread::yield();
+	}
+	for (int i = 0; i < options.operations; i++)
+	{
+		int first = random() % options.resources;
+		int second = random() % options.resources;
+		int first_amount = 1 + random() % options.units;
+		int second_amount = 1 + random() % options.units;
+		if (state.request(manager, task_id, first, first_amount) == DECISION_ABORTED
+				|| state.request(manager, task_id, second, second_amount) == DECISION_ABORTED)
+		{
+			state.start(manager, task_id);
+			continue;
+		}
+		if (random() % 8 == 0)
+		{
+			state.terminate(manager, task_id);
+			state.start(manager, task_id);
+			continue;
+		}
+		manager.release(task_id, first, first_amount);
+		manager.release(task_id, second, second_amount);
+	}
+	state.terminate(manager, task_id);
+}
+
+// One run at the given thread count. Returns false if the manager didn't end up with every unit back
+static bool runThreads(const BenchOptions &options, int num_threads)
+{
+	ConcurrentResourceManager manager(num_threads, vector<int>(options.resources, options.units));
+	StressState state(num_threads);
+	if (options.stress)
+		manager.setAbortObserver(bind(&StressState::checkAbort, &state, placeholders::_1));
+	atomic<bool> go(false);
+	vector<thread> threads;
+	for (int t = 0; t < num_threads; t++)
+	{
+		if (options.stress)
+			threads.push_back(thread(stressWorker, ref(manager), cref(options), t, ref(go), ref(state)));
+		else
+			threads.push_back(thread(scalingWorker, ref(manager), cref(options), t, ref(go)));
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	go = true;
+	for (unsigned int t = 0; t < threads.size(); t++)
+	{
+		threads[t].join();
+	}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	bool ok = manager.checkConservation(cerr) && state.unjustified_aborts.load() == 0;
+	for (int r = 0; r < options.resources; r++)
+	{
+		if (manager.getAvailable(r) != options.units)
+		{
+			cerr << "Resource " << r + 1 << " has " << manager.getAvailable(r) << " of " << options.units
+					<< " units available after every task terminated\n";
+			ok = false;
+		}
+	}
+
+	long long decisions = manager.getGrants() + manager.getAborts();
+	cout << num_threads << "\t" << decisions << "\t" << fixed << setprecision(0) << decisions / seconds << "\t"
+			<< setprecision(3) << (double)manager.getBlocks() / max(1LL, decisions) << "\t" << manager.getAborts()
+			<< "\t" << state.unjustified_aborts.load() << "\t" << (ok ? "ok" : "FAILED") << "\n";
+	return ok;
+}
+
+int main(int argc, char** argv)
+{
+	BenchOptions options = { 16, 8, 20000, 64, false };
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (arg.compare(0, 12, "--resources=") == 0)
+			options.resources = max(1, atoi(arg.c_str() + 12));
+		else if (arg.compare(0, 8, "--units=") == 0)
+			options.units = max(1, atoi(arg.c_str() + 8));
+		else if (arg.compare(0, 13, "--operations=") == 0)
+			options.operations = max(1, atoi(arg.c_str() + 13));
+		else if (arg.compare(0, 14, "--max-threads=") == 0)
+			options.max_threads = max(1, atoi(arg.c_str() + 14));
+		else if (arg == "--stress")
+			options.stress = true;
+		else
+		{
+			cerr << "Usage: " << argv[0] << " [--resources=N] [--units=N] [--operations=N] [--max-threads=N]"
+					" [--stress]\n";
+			return 1;
+		}
+	}
+
+	cout << (options.stress ? "Stress" : "Scaling") << ": " << options.resources << " resources of "
+			<< options.units << " units, " << options.operations << " operations per thread\n";
+	cout << "threads\tdecisions\tdecisions/s\tparked/decision\taborts\tunjustified aborts\tchecks\n";
+	bool ok = true;
+	for (int threads = 1; threads <= options.max_threads; threads *= 2)
+	{
+		ok = runThreads(options, threads) && ok;
+	}
+	return ok ? 0 : 1;
+}
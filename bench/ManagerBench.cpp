@@ -0,0 +1,280 @@
+// Throughput benchmark for both resource managers. Generates workloads of growing size (tasks x resource types
+// x actions per task) with tools/workload_gen, then runs each manager over each workload and reports simulated
+// cycles/s, actions/s, ns per dispatch and peak RSS. Every run happens in a forked child, so its peak RSS is its
+// own and not the high-water mark of everything before it. Results can also be written as JSON or CSV, with a
+// label (e.g. the commit), so runs from two commits can be diffed.
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include "data_types.h"
+#include "simulation.h"
+#include "trace_parser.h"
+
+using namespace std;
+
+struct BenchWorkload
+{
+	int tasks, resources, steps;
+};
+
+// What a child sends back to the parent over a pipe
+struct RunResult
+{
+	bool ok;
+	double seconds;
+	int cycles;
+	long long dispatches;
+	int aborted_tasks;
+};
+
+struct BenchResult
+{
+	BenchWorkload workload;
+	string manager;
+	long long actions;
+	RunResult run;			// the fastest repeat
+	long peak_rss_kb;		// the largest over the repeats
+};
+
+// Workloads are generated with plenty of units and low contention, so that runs end in a reasonable number
+// of cycles and the tasks mostly make progress instead of piling up in deadlocks
+static bool generateWorkload(const string &generator, const BenchWorkload &workload, const string &filename)
+{
+	ostringstream command;
+	command << generator << " --tasks=" << workload.tasks << " --resources=" << workload.resources
+			<< " --steps=" << workload.steps << " --units=50:100 --contention=0.1 --seed=2250 " << filename;
+	return system(command.str().c_str()) == 0;
+}
+
+// Run one manager over the input in a child process. Output goes to a stream with no buffer, which drops it
+static bool runInChild(const TraceInput &input, const ActionTable &action_table, bool banker, bool event_driven,
+		RunResult &result, long &peak_rss_kb)
+{
+	int fds[2];
+	if (pipe(fds) != 0)
+		return false;
+
+	pid_t pid = fork();
+	if (pid < 0)
+	{
+		close(fds[0]);
+		close(fds[1]);
+		return false;
+	}
+	if (pid == 0)
+	{
+		close(fds[0]);
+		RunResult child_result = { false, 0, 0, 0, 0 };
+		vector<int> resources(input.resources);
+		Simulation simulation;
+		simulation.setEventDriven(event_driven);
+		simulation.prepare(input.num_tasks, input.num_resources, resources.data());
+		simulation.bindStreams(action_table);
+		ostream discard(nullptr);
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		SimulationSummary summary = banker ? simulation.runBanker(discard) : simulation.runOptimistic(discard);
+		child_result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		child_result.ok = summary.completed;
+		child_result.cycles = summary.cycles;
+		child_result.dispatches = summary.dispatches;
+		child_result.aborted_tasks = summary.aborted_tasks;
+		bool sent = write(fds[1], &child_result, sizeof(child_result)) == sizeof(child_result);
+		_exit(sent ? 0 : 1);
+	}
+
+	close(fds[1]);
+	bool ok = read(fds[0], &result, sizeof(result)) == sizeof(result);
+	close(fds[0]);
+	int status = 0;
+	struct rusage usage;
+	ok = (wait4(pid, &status, 0, &usage) == pid) && ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+	peak_rss_kb = usage.ru_maxrss;
+	return ok && result.ok;
+}
+
+static double perSecond(double count, double seconds)
+{
+	return seconds > 0 ? count / seconds : 0;
+}
+
+static double nsPerDispatch(const BenchResult &result)
+{
+	return result.run.dispatches > 0 ? result.run.seconds * 1e9 / result.run.dispatches : 0;
+}
+
+// Rows are printed as each result comes in, since the larger workloads take a while
+static void printRow(const BenchResult &result)
+{
+	cout << fixed << result.workload.tasks << "\t" << result.workload.resources << "\t" << result.workload.steps
+			<< "\t" << result.manager << "\t" << result.actions << "\t" << result.run.cycles << "\t"
+			<< setprecision(0) << perSecond(result.run.cycles, result.run.seconds) << "\t\t"
+			<< perSecond(result.actions, result.run.seconds) << "\t"
+			<< setprecision(1) << nsPerDispatch(result) << "\t\t" << result.peak_rss_kb << endl;
+}
+
+static bool writeJson(const string &filename, const string &label, const vector<BenchResult> &results)
+{
+	ofstream out(filename.c_str());
+	out << "{\n  \"label\": \"" << label << "\",\n  \"results\": [\n";
+	out << setprecision(6);
+	for (unsigned int i = 0; i < results.size(); i++)
+	{
+		const BenchResult &result = results[i];
+		out << "    { \"tasks\": " << result.workload.tasks << ", \"resources\": " << result.workload.resources
+				<< ", \"steps\": " << result.workload.steps << ", \"manager\": \"" << result.manager
+				<< "\", \"actions\": " << result.actions << ", \"cycles\": " << result.run.cycles
+				<< ", \"dispatches\": " << result.run.dispatches << ", \"aborted\": " << result.run.aborted_tasks
+				<< ", \"seconds\": " << result.run.seconds
+				<< ", \"cycles_per_sec\": " << perSecond(result.run.cycles, result.run.seconds)
+				<< ", \"actions_per_sec\": " << perSecond(result.actions, result.run.seconds)
+				<< ", \"ns_per_dispatch\": " << nsPerDispatch(result)
+				<< ", \"peak_rss_kb\": " << result.peak_rss_kb << " }"
+				<< (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	out << "  ]\n}\n";
+	return out.good();
+}
+
+static bool writeCsv(const string &filename, const string &label, const vector<BenchResult> &results)
+{
+	ofstream out(filename.c_str());
+	out << "label,tasks,resources,steps,manager,actions,cycles,dispatches,aborted,seconds,"
+			"cycles_per_sec,actions_per_sec,ns_per_dispatch,peak_rss_kb\n";
+	out << setprecision(6);
+	for (unsigned int i = 0; i < results.size(); i++)
+	{
+		const BenchResult &result = results[i];
+		out << label << "," << result.workload.tasks << "," << result.workload.resources << ","
+				<< result.workload.steps << "," << result.manager << "," << result.actions << ","
+				<< result.run.cycles << "," << result.run.dispatches << "," << result.run.aborted_tasks << ","
+				<< result.run.seconds << "," << perSecond(result.run.cycles, result.run.seconds) << ","
+				<< perSecond(result.actions, result.run.seconds) << "," << nsPerDispatch(result) << ","
+				<< result.peak_rss_kb << "\n";
+	}
+	return out.good();
+}
+
+int main(int argc, char** argv)
+{
+	string generator = "./tools/workload_gen";
+	string json_file, csv_file, label;
+	int repeats = 3;
+	bool quick = false;
+	bool event_driven = false;
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (arg.compare(0, 12, "--generator=") == 0)
+			generator = arg.substr(12);
+		else if (arg.compare(0, 7, "--json=") == 0)
+			json_file = arg.substr(7);
+		else if (arg.compare(0, 6, "--csv=") == 0)
+			csv_file = arg.substr(6);
+		else if (arg.compare(0, 8, "--label=") == 0)
+			label = arg.substr(8);
+		else if (arg.compare(0, 9, "--repeat=") == 0)
+			repeats = max(1, atoi(arg.c_str() + 9));
+		else if (arg == "--quick")
+			quick = true;
+		else if (arg == "--event")
+			event_driven = true;
+		else
+		{
+			cerr << "Usage: " << argv[0] << " [--generator=path] [--json=file] [--csv=file] [--label=text]"
+					" [--repeat=N] [--quick] [--event]\n";
+			return 1;
+		}
+	}
+
+	vector<BenchWorkload> workloads;
+	const int task_counts[] = { 100, 250, 500 };
+	const int resource_counts[] = { 2, 4, 16 };	// 2 and 4 run the fixed-count loops
+	const int step_counts[] = { 4, 16 };
+	for (int t = 0; t < (quick ? 2 : 3); t++)
+	{
+		for (int r = 0; r < 3; r++)
+		{
+			for (int s = 0; s < 2; s++)
+			{
+				BenchWorkload workload = { task_counts[t], resource_counts[r], step_counts[s] };
+				workloads.push_back(workload);
+			}
+		}
+	}
+
+	char filename[] = "/tmp/manager_bench_XXXXXX";
+	int fd = mkstemp(filename);
+	if (fd < 0)
+	{
+		cerr << "Unable to create a temporary file\n";
+		return 1;
+	}
+	close(fd);
+
+	vector<BenchResult> results;
+	bool ok = true;
+	cout << "tasks\tres\tsteps\tmanager\tactions\tcycles\tcycles/s\tactions/s\tns/dispatch\tpeak RSS (KB)" << endl;
+	for (unsigned int w = 0; w < workloads.size() && ok; w++)
+	{
+		TraceInput input;
+		ParseError error;
+		if (!generateWorkload(generator, workloads[w], filename) || !parseTraceFile(filename, input, error))
+		{
+			cerr << "Unable to generate a workload with " << generator << " (make workload_gen)\n";
+			ok = false;
+			break;
+		}
+		const ActionTable action_table(input.num_tasks, input.actions);
+
+		for (int banker = 0; banker < 2 && ok; banker++)
+		{
+			BenchResult result;
+			result.workload = workloads[w];
+			result.manager = banker ? "banker" : "optimistic";
+			result.actions = input.actions.size();
+			result.peak_rss_kb = 0;
+			for (int r = 0; r < repeats && ok; r++)
+			{
+				RunResult run;
+				long peak_rss_kb = 0;
+				ok = runInChild(input, action_table, banker, event_driven, run, peak_rss_kb);
+				if (r == 0 || run.seconds < result.run.seconds)
+				{
+					result.run = run;
+				}
+				result.peak_rss_kb = max(result.peak_rss_kb, peak_rss_kb);
+			}
+			if (!ok)
+			{
+				cerr << "A " << result.manager << " run failed\n";
+				break;
+			}
+			results.push_back(result);
+			printRow(result);
+		}
+	}
+	unlink(filename);
+
+	if (ok && !json_file.empty() && !writeJson(json_file, label, results))
+	{
+		cerr << "Unable to write " << json_file << "\n";
+		ok = false;
+	}
+	if (ok && !csv_file.empty() && !writeCsv(csv_file, label, results))
+	{
+		cerr << "Unable to write " << csv_file << "\n";
+		ok = false;
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,428 @@
+// Load test for "ResourceAllocator serve". Starts a server in a child process on a temporary socket (or connects
+// to a running one with --socket), then drives it with a seeded workload one message at a time: every live task
+// initiates each resource type, then requests and releases random amounts until it terminates, with a tick
+// after each pass over the tasks and a reset once every task is done. Each round trip is timed, and the
+// decision latency (p50, p99, p999, max) is printed per message type along with the overall message rate.
+
+#include <algorithm>
+#include <chrono>
+#include <errno.h>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <signal.h>
+#include <sstream>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include "server.h"
+
+using namespace std;
+
+enum message_type_t { MESSAGE_INITIATE, MESSAGE_REQUEST, MESSAGE_RELEASE, MESSAGE_TERMINATE, MESSAGE_TICK,
+	MESSAGE_RESET, NUM_MESSAGE_TYPES };
+
+static const char* message_names[NUM_MESSAGE_TYPES] = { "initiate", "request", "release", "terminate", "tick",
+	"reset" };
+
+// The client's view of a task, kept in step with the server's replies
+struct ClientTask
+{
+	int initiated;				// resource types initiated so far
+	vector<int> claim;
+	vector<int> held;
+	bool blocked, done;
+	int blocked_resource, blocked_amount;
+	int actions_left;			// requests and releases before it terminates
+};
+
+// A blocking connection with a read buffer, one reply line at a time
+class Connection
+{
+	int fd;
+	char buffer[4096];
+	size_t start, end;
+public:
+	Connection() : fd(-1), start(0), end(0) {}
+	~Connection()
+	{
+		if (fd >= 0)
+			close(fd);
+	}
+
+	bool open(const string &path)
+	{
+		struct sockaddr_un address;
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		return fd >= 0 && connect(fd, (struct sockaddr*)&address, sizeof(address)) == 0;
+	}
+
+	void disconnect()
+	{
+		if (fd >= 0)
+			close(fd);
+		fd = -1;
+	}
+
+	bool send(const string &message)
+	{
+		size_t written = 0;
+		while (written < message.size())
+		{
+			ssize_t count = ::send(fd, message.data() + written, message.size() - written, MSG_NOSIGNAL);
+			if (count < 0 && errno != EINTR)
+				return false;
+			if (count > 0)
+				written += count;
+		}
+		return true;
+	}
+
+	bool readLine(string &line)
+	{
+		line.clear();
+		while (true)
+		{
+			for (size_t i = start; i < end; i++)
+			{
+				if (buffer[i] == '\n')
+				{
+					line.append(buffer + start, i - start);
+					start = i + 1;
+					return true;
+				}
+			}
+			line.append(buffer + start, end - start);
+			start = end = 0;
+			ssize_t count = read(fd, buffer, sizeof(buffer));
+			if (count < 0 && errno == EINTR)
+				continue;
+			if (count <= 0)
+				return false;
+			end = count;
+		}
+	}
+};
+
+class LoadTest
+{
+	Connection &connection;
+	bool banker;
+	int num_tasks;
+	vector<int> units;
+	mt19937 random;
+	vector<ClientTask> tasks;
+	vector<long long> latencies[NUM_MESSAGE_TYPES];
+	long long messages;
+	string reply;
+
+	int uniform(int low, int high)
+	{
+		return uniform_int_distribution<int>(low, high)(random);
+	}
+
+	// Send one message and wait for its reply, timing the round trip
+	bool roundTrip(message_type_t type, const string &message)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		if (!connection.send(message) || !connection.readLine(reply))
+		{
+			cerr << "Lost the connection to the server\n";
+			return false;
+		}
+		chrono::steady_clock::time_point end = chrono::steady_clock::now();
+		latencies[type].push_back(chrono::duration_cast<chrono::nanoseconds>(end - start).count());
+		messages++;
+		if (reply.compare(0, 5, "error") == 0)
+		{
+			cerr << "\"" << message.substr(0, message.size() - 1) << "\" failed: " << reply << "\n";
+			return false;
+		}
+		return true;
+	}
+
+	void startJob()
+	{
+		tasks.assign(num_tasks, ClientTask());
+		for (int t = 0; t < num_tasks; t++)
+		{
+			ClientTask &task = tasks[t];
+			task.initiated = 0;
+			task.held.assign(units.size(), 0);
+			task.claim.resize(units.size());
+			for (unsigned int r = 0; r < units.size(); r++)
+			{
+				task.claim[r] = uniform(1, units[r]);
+			}
+			task.blocked = task.done = false;
+			task.actions_left = uniform(4, 16);
+		}
+	}
+
+	void abortTask(int t)
+	{
+		tasks[t].done = true;
+		tasks[t].blocked = false;
+	}
+
+	// One action for task t: initiate the next resource type, or request, release or terminate
+	bool step(int t)
+	{
+		ClientTask &task = tasks[t];
+		ostringstream message;
+		if (task.initiated < (int)units.size())
+		{
+			int r = task.initiated++;
+			message << "initiate " << t + 1 << " " << r + 1 << " " << task.claim[r] << "\n";
+			if (!roundTrip(MESSAGE_INITIATE, message.str()))
+				return false;
+			if (reply == "abort")
+				abortTask(t);
+			return true;
+		}
+		if (task.actions_left == 0)
+		{
+			message << "terminate " << t + 1 << "\n";
+			task.done = true;
+			return roundTrip(MESSAGE_TERMINATE, message.str());
+		}
+		task.actions_left--;
+
+		int r = uniform(0, units.size() - 1);
+		if (task.held[r] > 0 && (task.held[r] == task.claim[r] || uniform(0, 2) == 0))
+		{
+			int amount = uniform(1, task.held[r]);
+			message << "release " << t + 1 << " " << r + 1 << " " << amount << "\n";
+			task.held[r] -= amount;
+			return roundTrip(MESSAGE_RELEASE, message.str());
+		}
+		if (task.held[r] == task.claim[r])
+			return true;
+
+		// Requests stay within the claim, so the Banker only blocks them
+		int amount = uniform(1, task.claim[r] - task.held[r]);
+		message << "request " << t + 1 << " " << r + 1 << " " << amount << "\n";
+		if (!roundTrip(MESSAGE_REQUEST, message.str()))
+			return false;
+		if (reply == "grant")
+		{
+			task.held[r] += amount;
+		}
+		else if (reply == "block")
+		{
+			task.blocked = true;
+			task.blocked_resource = r;
+			task.blocked_amount = amount;
+		}
+		else
+		{
+			abortTask(t);
+		}
+		return true;
+	}
+
+	// "tick <cycle> granted <ids...> aborted <ids...>"
+	bool tick()
+	{
+		if (!roundTrip(MESSAGE_TICK, "tick\n"))
+			return false;
+		istringstream words(reply);
+		string word;
+		bool granted = false;
+		words >> word >> word;
+		while (words >> word)
+		{
+			if (word == "granted" || word == "aborted")
+			{
+				granted = word == "granted";
+				continue;
+			}
+			int t = atoi(word.c_str()) - 1;
+			if (t < 0 || t >= num_tasks || !tasks[t].blocked)
+			{
+				cerr << "Unexpected tick reply: " << reply << "\n";
+				return false;
+			}
+			if (granted)
+			{
+				tasks[t].held[tasks[t].blocked_resource] += tasks[t].blocked_amount;
+				tasks[t].blocked = false;
+			}
+			else
+			{
+				abortTask(t);
+			}
+		}
+		return true;
+	}
+
+public:
+	LoadTest(Connection &connection, bool banker, int num_tasks, const vector<int> &units, int seed) :
+		connection(connection), banker(banker), num_tasks(num_tasks), units(units), random(seed), messages(0)
+	{
+	}
+
+	bool run(long long target_messages)
+	{
+		ostringstream reset;
+		reset << "reset " << num_tasks << "\n";
+		if (!roundTrip(MESSAGE_RESET, reset.str()))
+			return false;
+		startJob();
+		while (messages < target_messages)
+		{
+			bool any_live = false;
+			for (int t = 0; t < num_tasks; t++)
+			{
+				if (tasks[t].done)
+					continue;
+				any_live = true;
+				if (!tasks[t].blocked && !step(t))
+					return false;
+			}
+			if (!any_live)
+			{
+				if (!roundTrip(MESSAGE_RESET, reset.str()))
+					return false;
+				startJob();
+			}
+			else if (!tick())
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	long long getMessages()
+	{
+		return messages;
+	}
+
+	void printLatencies(ostream &out)
+	{
+		out << "message\tcount\tp50 (us)\tp99 (us)\tp999 (us)\tmax (us)\n";
+		out << fixed << setprecision(1);
+		for (int type = 0; type < NUM_MESSAGE_TYPES; type++)
+		{
+			vector<long long> &samples = latencies[type];
+			if (samples.empty())
+				continue;
+			sort(samples.begin(), samples.end());
+			size_t n = samples.size();
+			out << message_names[type] << "\t" << n << "\t" << samples[n / 2] / 1000.0 << "\t"
+					<< samples[min(n - 1, n * 99 / 100)] / 1000.0 << "\t"
+					<< samples[min(n - 1, n * 999 / 1000)] / 1000.0 << "\t" << samples[n - 1] / 1000.0 << "\n";
+		}
+	}
+};
+
+// Wait for a server started in a child to accept connections
+static bool connectWithRetry(Connection &connection, const string &path)
+{
+	for (int attempt = 0; attempt < 500; attempt++)
+	{
+		if (connection.open(path))
+			return true;
+		connection.disconnect();
+		usleep(10000);
+	}
+	return false;
+}
+
+int main(int argc, char** argv)
+{
+	string socket_path;
+	bool banker = false;
+	int num_tasks = 32;
+	int num_resources = 2;
+	int units = 10;
+	long long target_messages = 200000;
+	int seed = 2250;
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (arg.compare(0, 9, "--socket=") == 0)
+			socket_path = arg.substr(9);
+		else if (arg == "--banker")
+			banker = true;
+		else if (arg.compare(0, 8, "--tasks=") == 0)
+			num_tasks = max(1, atoi(arg.c_str() + 8));
+		else if (arg.compare(0, 12, "--resources=") == 0)
+			num_resources = max(1, atoi(arg.c_str() + 12));
+		else if (arg.compare(0, 8, "--units=") == 0)
+			units = max(1, atoi(arg.c_str() + 8));
+		else if (arg.compare(0, 11, "--messages=") == 0)
+			target_messages = max(1LL, atoll(arg.c_str() + 11));
+		else if (arg.compare(0, 7, "--seed=") == 0)
+			seed = atoi(arg.c_str() + 7);
+		else
+		{
+			cerr << "Usage: " << argv[0] << " [--socket=path] [--banker] [--tasks=N] [--resources=N] [--units=N]"
+					" [--messages=N] [--seed=N]\n";
+			return 1;
+		}
+	}
+	vector<int> resource_units(num_resources, units);
+
+	// Without --socket, serve from a child process; the server is sized by the reset the test starts with
+	pid_t server_pid = -1;
+	if (socket_path.empty())
+	{
+		socket_path = "/tmp/load_test_" + to_string(getpid()) + ".sock";
+		server_pid = fork();
+		if (server_pid < 0)
+		{
+			cerr << "Unable to start the server\n";
+			return 1;
+		}
+		if (server_pid == 0)
+		{
+			ServerOptions options = { socket_path, banker, num_tasks, resource_units };
+			_exit(runServer(options) ? 0 : 1);
+		}
+	}
+
+	bool ok;
+	double seconds = 0;
+	LoadTest* test = nullptr;
+	Connection connection;
+	if (!connectWithRetry(connection, socket_path))
+	{
+		cerr << "Unable to connect to " << socket_path << "\n";
+		ok = false;
+	}
+	else
+	{
+		test = new LoadTest(connection, banker, num_tasks, resource_units, seed);
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		ok = test->run(target_messages);
+		seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	}
+	connection.disconnect();
+
+	if (server_pid > 0)
+	{
+		kill(server_pid, SIGTERM);
+		int status;
+		waitpid(server_pid, &status, 0);
+	}
+	if (test == nullptr)
+		return 1;
+
+	cout << (banker ? "Banker" : "FIFO") << ", " << num_tasks << " tasks, " << num_resources << " resources of "
+			<< units << " units\n";
+	test->printLatencies(cout);
+	cout << test->getMessages() << " messages in " << setprecision(3) << seconds << " s ("
+			<< setprecision(0) << test->getMessages() / seconds << " messages/s)\n";
+	delete test;
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,156 @@
+// Throughput of ShardedResourceManager against shard count. A fixed number of threads, each driving its own task,
+// request a random amount of a random resource among thousands and release it again; decisions per second are
+// reported for 1 to 64 shards. With --stress, tasks hold two resources at a time, usually in different shards,
+// so deadlocks span shards and have to be found from the shards' counts; an aborted task starts over, and every
+// abort must be made while each live task is inside request() (see stress_state.h). Every run ends with the
+// conservation check (held + available == units, and every unit back once the tasks are done), and the exit
+// status is 1 if any run fails a check.
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "sharded_manager.h"
+#include "stress_state.h"
+
+using namespace std;
+
+struct BenchOptions
+{
+	int threads, resources, units, operations, max_shards;
+	bool stress;
+};
+
+// Request, then release, one resource at a time
+static void worker(ShardedResourceManager &manager, const BenchOptions &options, int task_id, atomic<bool> &go)
+{
+	mt19937 random(task_id + 1);
+	manager.start(task_id);
+	while (!go.load())
+	{
+		this_thread::yield();
+	}
+	for (int i = 0; i < options.operations; i++)
+	{
+		int resource_id = random() % options.resources;
+		int amount = 1 + random() % options.units;
+		if (manager.request(task_id, resource_id, amount) == DECISION_GRANTED)
+			manager.release(task_id, resource_id, amount);
+	}
+	manager.terminate(task_id);
+}
+
+// Hold two resources at a time, so tasks deadlock across shards; an aborted task starts over
+static void stressWorker(ShardedResourceManager &manager, const BenchOptions &options, int task_id,
+		atomic<bool> &go, StressState &state)
+{
+	mt19937 random(task_id + 1);
+	state.start(manager, task_id);
+	while (!go.load())
+	{
+		this_thread::yield();
+	}
+	for (int i = 0; i < options.operations; i++)
+	{
+		int first = random() % options.resources;
+		int first_amount = 1 + random() % options.units;
+		int second = random() % options.resources;
+		int second_amount = 1 + random() % options.units;
+		if (state.request(manager, task_id, first, first_amount) == DECISION_ABORTED
+				|| state.request(manager, task_id, second, second_amount) == DECISION_ABORTED)
+		{
+			state.start(manager, task_id);
+			continue;
+		}
+		manager.release(task_id, first, first_amount);
+		manager.release(task_id, second, second_amount);
+	}
+	state.terminate(manager, task_id);
+}
+
+static bool runShards(const BenchOptions &options, int num_shards)
+{
+	ShardedResourceManager manager(options.threads, vector<int>(options.resources, options.units), num_shards);
+	StressState state(options.threads);
+	if (options.stress)
+		manager.setAbortObserver(bind(&StressState::checkAbort, &state, placeholders::_1));
+	atomic<bool> go(false);
+	vector<thread> threads;
+	for (int t = 0; t < options.threads; t++)
+	{
+		if (options.stress)
+			threads.push_back(thread(stressWorker, ref(manager), cref(options), t, ref(go), ref(state)));
+		else
+			threads.push_back(thread(worker, ref(manager), cref(options), t, ref(go)));
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	go = true;
+	for (unsigned int t = 0; t < threads.size(); t++)
+	{
+		threads[t].join();
+	}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	bool ok = manager.checkConservation(cerr) && state.unjustified_aborts.load() == 0;
+	for (int r = 0; r < options.resources; r++)
+	{
+		if (manager.getAvailable(r) != options.units)
+		{
+			cerr << "Resource " << r + 1 << " has " << manager.getAvailable(r) << " of " << options.units
+					<< " units available after every task terminated\n";
+			ok = false;
+		}
+	}
+
+	long long decisions = manager.getGrants() + manager.getAborts();
+	cout << manager.getNumShards() << "\t" << decisions << "\t" << fixed << setprecision(0) << decisions / seconds
+			<< "\t" << setprecision(3) << (double)manager.getBlocks() / max(1LL, decisions) << "\t"
+			<< manager.getAborts() << "\t" << state.unjustified_aborts.load() << "\t" << (ok ? "ok" : "FAILED")
+			<< "\n";
+	return ok;
+}
+
+int main(int argc, char** argv)
+{
+	BenchOptions options = { 8, 4096, 4, 50000, 64, false };
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (arg.compare(0, 10, "--threads=") == 0)
+			options.threads = max(1, atoi(arg.c_str() + 10));
+		else if (arg.compare(0, 12, "--resources=") == 0)
+			options.resources = max(1, atoi(arg.c_str() + 12));
+		else if (arg.compare(0, 8, "--units=") == 0)
+			options.units = max(1, atoi(arg.c_str() + 8));
+		else if (arg.compare(0, 13, "--operations=") == 0)
+			options.operations = max(1, atoi(arg.c_str() + 13));
+		else if (arg.compare(0, 13, "--max-shards=") == 0)
+			options.max_shards = max(1, atoi(arg.c_str() + 13));
+		else if (arg == "--stress")
+			options.stress = true;
+		else
+		{
+			cerr << "Usage: " << argv[0] << " [--threads=N] [--resources=N] [--units=N] [--operations=N]"
+					" [--max-shards=N] [--stress]\n";
+			return 1;
+		}
+	}
+
+	cout << (options.stress ? "Stress" : "Throughput") << ": " << options.threads << " threads, "
+			<< options.resources << " resources of " << options.units << " units, " << options.operations
+			<< " operations per thread\n";
+	cout << "shards\tdecisions\tdecisions/s\tparked/decision\taborts\tunjustified aborts\tchecks\n";
+	bool ok = true;
+	for (int shards = 1; shards <= options.max_shards; shards *= 2)
+	{
+		ok = runShards(options, shards) && ok;
+	}
+	return ok ? 0 : 1;
+}
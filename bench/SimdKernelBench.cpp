@@ -0,0 +1,87 @@
+// Micro-benchmark for the SIMD kernels in simd_kernels.h. For 64, 256 and 1024 resource types it times
+// every kernel variant this CPU supports on its worst case (a full scan) and reports the speedup over scalar.
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "simd_kernels.h"
+
+using namespace std;
+
+static const int NUM_WAITING = 4096;
+static volatile bool sink;
+
+// Run fn enough times to take ~50ms and return nanoseconds per call
+template <typename Fn>
+static double timePerCall(Fn fn)
+{
+	long iterations = 1;
+	while (true)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (long i = 0; i < iterations; i++)
+		{
+			sink = fn();
+		}
+		double elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+		if (elapsed > 5e7)
+		{
+			return elapsed / iterations;
+		}
+		iterations *= 2;
+	}
+}
+
+int main()
+{
+	const SimdKernels* variants[3];
+	int num_variants = simdKernelVariants(variants, 3);
+	const int sizes[] = { 64, 256, 1024 };
+	mt19937 rng(2250);
+
+	cout << "kernel\t\t\tresources\tvariant\tns/call\tspeedup\n";
+	for (int s = 0; s < 3; s++)
+	{
+		int num_resources = sizes[s];
+
+		// need <= available everywhere, so allLessEqual has to look at every resource
+		vector<int> need(num_resources), available(num_resources);
+		for (int i = 0; i < num_resources; i++)
+		{
+			need[i] = rng() % 8;
+			available[i] = need[i] + rng() % 4;
+		}
+
+		// Every waiting request asks for one more unit than is available, so anySatisfiable scans them all
+		vector<int> amounts(NUM_WAITING), resource_ids(NUM_WAITING);
+		for (int i = 0; i < NUM_WAITING; i++)
+		{
+			resource_ids[i] = rng() % num_resources;
+			amounts[i] = available[resource_ids[i]] + 1;
+		}
+
+		double scalar_le = 0, scalar_any = 0;
+		for (int v = 0; v < num_variants; v++)
+		{
+			const SimdKernels &k = *variants[v];
+			double le = timePerCall([&]() { return k.allLessEqual(need.data(), available.data(), num_resources); });
+			double any = timePerCall([&]() {
+				return k.anySatisfiable(amounts.data(), resource_ids.data(), NUM_WAITING, available.data());
+			});
+			if (v == 0)
+			{
+				scalar_le = le;
+				scalar_any = any;
+			}
+			cout << fixed << setprecision(1)
+				 << "allLessEqual\t\t" << num_resources << "\t\t" << k.name << "\t" << le << "\t"
+				 << setprecision(2) << scalar_le / le << "x\n"
+				 << setprecision(1)
+				 << "anySatisfiable(" << NUM_WAITING << ")\t" << num_resources << "\t\t" << k.name << "\t" << any << "\t"
+				 << setprecision(2) << scalar_any / any << "x\n";
+		}
+	}
+	return 0;
+}
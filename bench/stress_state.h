@@ -0,0 +1,76 @@
+/*
+ * stress_state.h
+ *
+ * What the stress threads of concurrent_bench and shard_bench say about their own tasks, for checking every abort
+ * the manager makes. live is set once start() has returned and cleared before terminate() is called, or once
+ * request() has returned DECISION_ABORTED; in_request is set for the whole of each request() call. So a task that
+ * is live here and not in a request is live and running as far as the manager is concerned too, and the manager
+ * must not abort anyone while it is. Works with any manager that has ParkingManager's start, request and
+ * terminate
+ */
+
+#ifndef BENCH_STRESS_STATE_H_
+#define BENCH_STRESS_STATE_H_
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include "resalloc.h"
+
+struct StressState
+{
+	std::unique_ptr<std::atomic<bool>[]> live, in_request;
+	int num_tasks;
+	std::atomic<long long> unjustified_aborts;
+
+	explicit StressState(int tasks) : live(new std::atomic<bool>[tasks]), in_request(new std::atomic<bool>[tasks]),
+		num_tasks(tasks), unjustified_aborts(0)
+	{
+		for (int t = 0; t < tasks; t++)
+		{
+			live[t] = false;
+			in_request[t] = false;
+		}
+	}
+
+	// Called by the manager as it aborts a task
+	void checkAbort(int victim)
+	{
+		for (int t = 0; t < num_tasks; t++)
+		{
+			if (live[t].load() && !in_request[t].load())
+			{
+				std::cerr << "Task " << victim + 1 << " was aborted while task " << t + 1 << " was running\n";
+				unjustified_aborts++;
+				return;
+			}
+		}
+	}
+
+	template <class Manager>
+	void start(Manager &manager, int task_id)
+	{
+		manager.start(task_id);
+		live[task_id] = true;
+	}
+
+	template <class Manager>
+	void terminate(Manager &manager, int task_id)
+	{
+		live[task_id] = false;
+		manager.terminate(task_id);
+	}
+
+	template <class Manager>
+	decision_t request(Manager &manager, int task_id, int resource_id, int amount)
+	{
+		in_request[task_id] = true;
+		decision_t decision = manager.request(task_id, resource_id, amount);
+		if (decision == DECISION_ABORTED)
+			live[task_id] = false;
+		in_request[task_id] = false;
+		return decision;
+	}
+};
+
+#endif /* BENCH_STRESS_STATE_H_ */
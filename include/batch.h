@@ -0,0 +1,24 @@
+/*
+ * batch.h
+ *
+ * Batch mode: simulate many input files in one process, across a work-stealing thread pool.
+ */
+
+#ifndef INCLUDE_BATCH_H_
+#define INCLUDE_BATCH_H_
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// The inputs named by path. A directory contributes every regular file whose name starts with "input",
+// sorted by name. Any other file is read as a manifest: one input path per line, blank lines and lines
+// starting with '#' skipped, relative paths taken relative to the manifest's directory
+bool listBatchInputs(const std::string &path, std::vector<std::string> &inputs, std::string &error);
+
+// Simulate every input on jobs workers. Each input's output is the same as a single run on it, under an
+// "==> path <==" heading, and is written in input order as soon as every input before it is done.
+// An aggregate summary follows. Returns the number of inputs that couldn't be read
+int runBatch(const std::vector<std::string> &inputs, int jobs, bool event_driven, std::ostream &out);
+
+#endif /* INCLUDE_BATCH_H_ */
@@ -0,0 +1,102 @@
+/*
+ * batched_allocator.h
+ *
+ * BatchedAllocator: an actor-style front end to the FIFO (Optimistic) manager. Threads that make requests don't
+ * touch allocator state at all; they push their actions into a lock-free multi-producer single-consumer ring, and
+ * one core thread, which owns an OnlineAllocator, drains the ring a batch at a time. Each action in a batch is
+ * dispatched (dispatchRunnable, so dispatchAction) with the usual FIFO rules, and then the batch ends with one
+ * tick: the deadlock check, commitReleasedResources and the retry of blocked requests are paid once per batch,
+ * however many actions it held, and the manager's state stays in the core thread's cache.
+ *
+ * Decisions are published back to a slot per task. A request that blocks is answered by the tick that grants it
+ * or aborts it to break a deadlock, so, as with the concurrent managers, request() returns DECISION_GRANTED or
+ * DECISION_ABORTED. Each task is driven by one thread at a time; ids are 0-based. Released units can be granted
+ * from the end of the batch the release is in
+ */
+
+#ifndef INCLUDE_BATCHED_ALLOCATOR_H_
+#define INCLUDE_BATCHED_ALLOCATOR_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "online_allocator.h"
+
+// Actions the ring holds; a producer that finds it full yields until the core catches up. A power of two
+#define BATCH_RING_SIZE (1 << 12)
+
+// Most actions the core applies before it ticks, so that a steady stream of actions still gets its releases
+// committed and its blocked requests retried
+#define DEFAULT_MAX_BATCH 1024
+
+class BatchedAllocator
+{
+	struct BatchMessage
+	{
+		action_t type;
+		int task_id, resource_id, amount;
+	};
+
+	// The cell at position p is free for the producer that claims p while sequence == p, and holds a message
+	// for the core once sequence == p + 1
+	struct RingCell
+	{
+		std::atomic<unsigned long> sequence;
+		BatchMessage message;
+	};
+
+	// published counts the decisions made for the task; decision is the latest, written before published moves
+	struct DecisionSlot
+	{
+		std::atomic<unsigned int> published;
+		unsigned int submitted;				// only the task's own thread touches it
+		decision_t decision;
+		std::atomic<bool> waiting;			// the task's thread is asleep on ready
+		std::mutex lock;
+		std::condition_variable ready;
+	};
+
+	std::vector<RingCell> ring;
+	std::atomic<unsigned long> enqueue_position;
+	unsigned long dequeue_position;			// only the core moves it
+	std::vector<std::unique_ptr<DecisionSlot> > slots;
+	OnlineAllocator allocator;				// only the core thread touches it
+	int max_batch;
+	std::vector<int> granted, aborted;		// the core's scratch space for tick
+	std::atomic<bool> stopping;
+	std::atomic<bool> core_sleeping;
+	std::mutex core_lock;
+	std::condition_variable core_wakeup;
+	std::atomic<long long> messages, batches, ticks;
+	std::thread core;
+
+	void push(const BatchMessage &message);
+	bool pop(BatchMessage &message);
+	bool ringEmpty();
+	void sleepUntilPushed();
+	void runCore();
+	void apply(const BatchMessage &message);
+	void publish(int task_id, decision_t decision);
+	decision_t submit(action_t type, int task_id, int resource_id, int amount);
+	BatchedAllocator(const BatchedAllocator &other);
+	BatchedAllocator &operator=(const BatchedAllocator &other);
+public:
+	BatchedAllocator(int num_tasks, const std::vector<int> &units, int max_batch = DEFAULT_MAX_BATCH);
+	// Answers whatever is still in the ring, then stops the core
+	~BatchedAllocator();
+
+	decision_t initiate(int task_id, int resource_id, int claim);
+	decision_t request(int task_id, int resource_id, int amount);
+	decision_t release(int task_id, int resource_id, int amount);
+	// Releases whatever the task still holds
+	decision_t terminate(int task_id);
+
+	long long getMessages() const;
+	long long getBatches() const;
+	long long getTicks() const;
+};
+
+#endif /* INCLUDE_BATCHED_ALLOCATOR_H_ */
@@ -0,0 +1,104 @@
+/*
+ * binary_trace.h
+ *
+ * Versioned binary trace format. A trace is converted once from the text format and then mapped and
+ * used in place: the action records have the same layout as Action, so the loader hands them to an
+ * ActionTable without copying or parsing anything.
+ *
+ * Layout (version 1, native byte order, every field a 4-byte integer):
+ *   BinaryTraceHeader
+ *   resources[num_resources]     - units of each resource type
+ *   offsets[num_tasks + 1]       - task i's records are records[offsets[i]] up to records[offsets[i + 1]]
+ *   records[num_actions]         - type, task id, delay, resource id, amount (ids are 0-based), grouped per task
+ */
+
+#ifndef INCLUDE_BINARY_TRACE_H_
+#define INCLUDE_BINARY_TRACE_H_
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <string>
+#include "data_types.h"
+#include "trace_parser.h"
+
+#define BINARY_TRACE_MAGIC "RATRACE"
+#define BINARY_TRACE_VERSION 1
+#define BINARY_TRACE_BYTE_ORDER 0x01020304
+
+struct BinaryTraceHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint32_t record_size;
+	int32_t num_tasks;
+	int32_t num_resources;
+	int32_t num_actions;
+};
+
+// A read-only mapping of a binary trace. The ActionTable it hands out borrows the mapped records,
+// so the BinaryTrace must outlive every table and stream taken from it
+class BinaryTrace
+{
+	void* mapping;
+	size_t mapping_size;
+	const BinaryTraceHeader* header;
+	const int32_t* resources;
+	const int32_t* offsets;
+	const Action* records;
+
+	BinaryTrace(const BinaryTrace &other);
+	BinaryTrace &operator=(const BinaryTrace &other);
+	bool validate(ParseError &error);
+public:
+	BinaryTrace();
+	~BinaryTrace();
+	bool open(const std::string &filename, ParseError &error);
+	void close();
+	int getNumTasks() const;
+	int getNumResources() const;
+	int getNumActions() const;
+	const int* getResources() const;
+	ActionTable getActionTable() const;
+};
+
+// Streams a binary trace instead of mapping all of it. Each task gets a window of at most window_size actions,
+// read with pread when the task runs off the end of its previous window; the window after it is prefetched
+// with posix_fadvise. A task's window is freed once it terminates or is aborted, so memory is bounded by
+// the number of live tasks times the window size, not by the length of the trace
+class BinaryTraceReader : public ActionSource
+{
+	int fd, window_size;
+	bool failed;
+	BinaryTraceHeader header;
+	std::vector<int> resources;
+	std::vector<int32_t> offsets;		// offsets[num_tasks + 1], as in the file
+	std::vector<int32_t> next_record;	// per task, the first record not yet read into its window
+	std::vector<actionvec_t> windows;
+	off_t records_start;
+
+	BinaryTraceReader(const BinaryTraceReader &other);
+	BinaryTraceReader &operator=(const BinaryTraceReader &other);
+	bool readAt(void* buffer, size_t size, off_t position);
+	void fail(int task_id, ActionStream &stream, const std::string &message);
+public:
+	BinaryTraceReader();
+	~BinaryTraceReader();
+	bool open(const std::string &filename, int window, ParseError &error);
+	void close();
+	int getNumTasks() const;
+	int getNumResources() const;
+	const int* getResources() const;
+	ActionStream getStream(int task_id);
+	void refill(int task_id, ActionStream &stream);
+	void release(int task_id);
+	bool hasFailed() const;
+};
+
+// True if the file starts with the binary trace magic
+bool isBinaryTraceFile(const std::string &filename);
+
+// Write input (header and file-order actions) as a binary trace. Returns false and fills in error on failure
+bool writeBinaryTrace(const std::string &filename, const TraceInput &input, ParseError &error);
+
+#endif /* INCLUDE_BINARY_TRACE_H_ */
@@ -0,0 +1,72 @@
+/*
+ * concurrent_manager.h
+ *
+ * ConcurrentResourceManager: the Optimistic (FIFO) manager for many threads deciding at once, without a lock
+ * around the whole manager. Each task is driven by one thread at a time; different tasks run concurrently.
+ *
+ * Units available are atomics and a request is granted with a CAS loop, so threads that don't have to wait
+ * never take a lock. A request that can't be granted parks its thread on the resource's wait list (the only
+ * place a per-resource lock is taken), and a release hands the units to the waiters that now fit, in the
+ * order they parked, as the Optimistic manager retries blocked tasks in order. While a resource has waiters,
+ * new requests for it queue behind them instead of barging in.
+ *
+ * There are no cycles: released units are available at once. When every started task is parked, the lowest
+ * numbered one is aborted and what it holds is released, again until some waiter can go on, as the
+ * Optimistic manager resolves a deadlock. Only for the Optimistic rules; claims aren't tracked. The task slots,
+ * wait lists and deadlock resolution are ParkingManager's (parking_manager.h)
+ */
+
+#ifndef INCLUDE_CONCURRENT_MANAGER_H_
+#define INCLUDE_CONCURRENT_MANAGER_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "parking_manager.h"
+
+class ConcurrentResourceManager : public ParkingManager<ConcurrentResourceManager>
+{
+	struct ResourceSlot
+	{
+		std::atomic<int> available;
+		std::atomic<int> waiters;		// parked, or about to park; new requests queue behind them
+		std::mutex lock;				// guards the wait list
+		WaitList waiting;
+	};
+
+	std::vector<std::unique_ptr<ResourceSlot> > resources;
+	// Live tasks (started and not done or aborted) in the high 32 bits, parked tasks (not yet granted or aborted)
+	// in the low 32, so one load sees both at the same moment
+	std::atomic<unsigned long long> counts;
+
+	bool takeUnits(int resource_id, int amount);
+	decision_t park(int task_id, int resource_id, int amount);
+
+	// ParkingManager's policy
+	std::mutex &lockOf(int resource_id);
+	WaitList &waitListOf(int resource_id);
+	int unitsAvailable(int resource_id);
+	void giveBack(int resource_id, int amount);
+	void countStarted();
+	bool countParked(int resource_id);
+	void countWoken(int resource_id);
+	void countAborted(int resource_id);
+	bool countEnded();
+	bool allParked();
+	friend class ParkingManager<ConcurrentResourceManager>;
+
+	ConcurrentResourceManager(const ConcurrentResourceManager &other);
+	ConcurrentResourceManager &operator=(const ConcurrentResourceManager &other);
+public:
+	ConcurrentResourceManager(int num_tasks, const std::vector<int> &units);
+
+	// Block until the units are granted (DECISION_GRANTED) or the task is aborted to break a deadlock
+	decision_t request(int task_id, int resource_id, int amount);
+	// Never parks: DECISION_GRANTED or DECISION_BLOCKED
+	decision_t tryRequest(int task_id, int resource_id, int amount);
+
+	int getAvailable(int resource_id) const;
+};
+
+#endif /* INCLUDE_CONCURRENT_MANAGER_H_ */
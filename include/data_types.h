@@ -8,6 +8,11 @@
 #ifndef INCLUDE_DATA_TYPES_H_
 #define INCLUDE_DATA_TYPES_H_
 
+#include <functional>
+#include <iosfwd>
+#include <queue>
+#include <set>
+#include <utility>
 #include <vector>
 
 typedef enum action_type
@@ -30,6 +35,7 @@ class Action
 public:
 	Action(action_t typ, int t_id, int d, int res_id, int amt);
 	Action(const Action &action);
+	Action &operator=(const Action &action);
 
 	action_t getType() const;
 	int getTaskId() const;
@@ -38,18 +44,118 @@ public:
 	int getAmount() const;
 };
 
+typedef std::vector<Action> actionvec_t;
+
+class ActionStream;
+struct RunStats;
+class EventTracer;
+
+// ActionSource supplies a task's actions a window at a time, for streams that don't hold every action
+// in memory. refill is called when a stream runs off the end of its window, and release once the task
+// is done with its actions, so the source can free whatever it buffered for that task
+class ActionSource
+{
+public:
+	virtual ~ActionSource() {}
+	virtual void refill(int task_id, ActionStream &stream) = 0;
+	virtual void release(int task_id) = 0;
+};
+
+// ActionStream is a task's cursor over its slice of an ActionTable. Advancing is O(1) and never
+// moves or invalidates the underlying actions.
+// A stream bound to an ActionSource only sees one window of actions; advancing past the end of the window
+// asks the source for the next one, which invalidates pointers into the previous window
+class ActionStream
+{
+	const Action* next_action;
+	const Action* end;
+	ActionSource* source;
+	int task_id;
+public:
+	ActionStream();
+	ActionStream(const Action* first, const Action* last);
+	ActionStream(ActionSource* action_source, int id);
+	const Action* current() const;
+	bool exhausted() const;
+	void advance();
+	void setWindow(const Action* first, const Action* last);
+	void close();
+	int remaining() const;
+};
+
+// ActionTable holds every task's actions in one contiguous, immutable array, grouped by task.
+// The actions for task i are actions[offsets[i]] up to (not including) actions[offsets[i + 1]].
+// A single parsed table is shared read-only by every run over the same input.
+// The table either owns its arrays (text input) or borrows them from a mapped binary trace
+class ActionTable
+{
+	actionvec_t actions;
+	std::vector<int> offsets;
+	const Action* mapped_actions;
+	const int* mapped_offsets;
+	int num_tasks, num_actions;
+	bool sanityCheck(int task_id) const;
+	const Action* actionData() const;
+	const int* offsetData() const;
+public:
+	ActionTable();
+	ActionTable(int n_tasks, const actionvec_t &file_order_actions);
+	ActionTable(int n_tasks, int n_actions, const Action* grouped_actions, const int* task_offsets);
+	void rebuild(int n_tasks, const actionvec_t &file_order_actions);
+	int getNumTasks() const;
+	int getNumActions() const;
+	ActionStream getStream(int task_id) const;
+};
+
+// AllocationMatrix holds what every task holds and claims, and its need (claimed - held), in contiguous
+// arrays owned by the resource manager. Task-major views are indexed [task * num_resources + resource] and
+// resource-major views [resource * num_tasks + task], so checks across tasks or across resources both
+// stream through memory instead of chasing per-task heap arrays
+class AllocationMatrix
+{
+	int num_tasks, num_resources;
+	std::vector<int> held, claimed, need;
+	std::vector<int> held_by_resource, need_by_resource;
+	bool sanityCheck(int task_id, int resource_id) const;
+public:
+	AllocationMatrix(int n_tasks, int n_resources);
+	void reset();
+	void resize(int n_tasks, int n_resources);
+	void setHeld(int task_id, int resource_id, int amount);
+	void setClaim(int task_id, int resource_id, int amount);
+	int getHeld(int task_id, int resource_id) const;
+	int getClaim(int task_id, int resource_id) const;
+	int getNeed(int task_id, int resource_id) const;
+	const int* heldRow(int task_id) const;
+	const int* needRow(int task_id) const;
+	const int* heldColumn(int resource_id) const;
+	const int* needColumn(int resource_id) const;
+	int getNumTasks() const;
+	int getNumResources() const;
+};
+
+// Counts of a manager's tasks by state. Tasks update them on every state change, so "is every live task
+// blocked" and "has every task finished" are O(1) instead of scans over the task list.
+// Finished means terminated or aborted (isDoneOrAborted); runnable and blocked only count live tasks
+struct TaskCounters
+{
+	int runnable, blocked, finished, aborted;
+};
+
 // Tasks are the "running" blocks of work that request, claim, and otherwise
-// consume resources.
+// consume resources. What a task holds and claims lives in its manager's AllocationMatrix,
+// at the row given by the task id.
 class Task {
-	int* resources_held;
-	int* resources_claimed;
-	int id, time_created, time_blocked, time_terminated, num_resources, delay, blocked_since;
+	AllocationMatrix* allocations;
+	TaskCounters* counters;
+	int id, time_created, time_blocked, time_terminated, delay, blocked_since, wake_cycle;
 	bool blocked, aborted;
-	Action* action_ptr;
+	ActionStream actions;
+	Action end_of_actions;		// what the task sees once its stream is used up
 	bool sanityCheck(int i) const;
+	void countTransition(bool was_blocked, bool was_finished);
 public:
-	Task(int n_resources, int i);
-	~Task();
+	Task(AllocationMatrix &matrix, TaskCounters &task_counters, int i);
 	void setResourceHeld(int i, int amount);
 	void setResourceClaimed(int i, int amount);
 	void setDelay(int i);
@@ -57,11 +163,15 @@ public:
 	void setTimeTerminated(int i);
 	void setTimeCreated(int i);
 	void setBlockedSince(int i);
+	void setWakeCycle(int i);
 	void block();
 	void incrementTimeBlocked();
+	void addTimeBlocked(int cycles);
 	void unblock();
 	void abort();
-	void bindActionPointer(Action &action);
+	void bindActionStream(const ActionStream &stream);
+	void closeActionStream();
+	void advanceAction();
 	int getResourceHeld(int i) const;
 	int getResourceClaim(int i) const;
 	int getId() const;
@@ -73,77 +183,239 @@ public:
 	bool isDoneOrAborted() const;
 	int getTimeBlocked() const;
 	int getBlockedSince() const;
-	Action* getActionPointer() const;
+	int getWakeCycle() const;
+	const Action* getActionPointer() const;
 
 	void grantResources(int i, int amount);
 	void releaseResources(int i, int amount);
 };
 
 typedef std::vector<Task> taskvec_t;
-typedef std::vector<Action> actionvec_t;
-typedef std::vector<actionvec_t> ActionContainer_t;
+// TaskQueue is an intrusive FIFO list of task ids. The resource manager uses one to keep blocked tasks in
+// the order they were blocked, and another to keep live tasks in id order, so the dispatch order for a
+// cycle comes from walking lists instead of sorting the task list
+class TaskQueue
+{
+	std::vector<int> prev, next;
+	std::vector<bool> member;
+	int head, tail, count;
+	bool sanityCheck(int id) const;
+public:
+	TaskQueue(int n_tasks = 0);
+	void resize(int n_tasks);
+	void pushBack(int id);
+	void remove(int id);
+	void clear();
+	bool contains(int id) const;
+	bool empty() const;
+	int size() const;
+	int front() const;
+	int back() const;
+	int nextOf(int id) const;
+	void insertBefore(int id, int before);
+};
+
+// WaitQueues keeps a FIFO list of blocked task ids per resource, in the order they blocked, plus a lower bound
+// on the smallest request in each list. A task waits on at most one resource, so all the lists share one set
+// of link arrays indexed by task id
+class WaitQueues
+{
+	std::vector<int> prev, next, resource_of;	// resource_of[id] is -1 if the task isn't waiting
+	std::vector<int> head, tail, min_amount;
+	bool sanityCheck(int id) const;
+public:
+	WaitQueues(int n_tasks = 0, int n_resources = 0);
+	void resize(int n_tasks, int n_resources);
+	void pushBack(int id, int resource_id, int amount);
+	void remove(int id);
+	bool contains(int id) const;
+	int front(int resource_id) const;
+	int nextOf(int id) const;
+	int getMinAmount(int resource_id) const;
+	void setMinAmount(int resource_id, int amount);
+};
+
+// Min-heap of (cycle, task id) pairs, used to find the next delay expiry in event-driven mode
+typedef std::pair<int, int> wakeup_t;
+typedef std::priority_queue<wakeup_t, std::vector<wakeup_t>, std::greater<wakeup_t> > WakeupQueue_t;
 
 // The ResourceManager class is the parent class for Optimistic and Banker resource
 // managers. The class knows the total resources claimed, how many are available,
 // and the total number of tasks.
 class ResourceManager {
-	int* total_resources;
-	int* resources_available;
-	int* resources_claimed;
-	int* cycle_resources_changed;
+	std::vector<int> total_resources;
+	std::vector<int> resources_available;
+	std::vector<int> cycle_resources_changed;
+	std::vector<long long> units_returned;	// per resource, all the units committed back to the pool so far
+	AllocationMatrix allocations;
+	TaskCounters task_counters;
 	int num_tasks, num_resources, cycle;
+	long long dispatch_count;	// actions dispatched since the last reset, for benchmarks
+	bool event_driven, resources_released, releases_pending;
+	WakeupQueue_t wakeups;
+	TaskQueue blocked_queue;	// blocked tasks, in the order they were blocked (FIFO)
+	TaskQueue live_tasks;		// tasks that are not done or aborted, in id order
+	TaskQueue woken_tasks;		// tasks unblocked earlier in the current cycle
+	TaskQueue runnable_tasks;	// live tasks that aren't blocked, in id order (only kept with wait queues)
+	WaitQueues wait_queues;		// blocked tasks per resource (only kept with wait queues)
+	std::vector<int> changed_resources;		// resources whose units went up at the last commit
+	std::vector<int> blocked_charged;		// per task, the last cycle its time blocked has been counted up to
+	std::vector<int> woken_ids;
+	std::vector<int> waiting_resource, waiting_amount;	// blocked request per task id; amount is INT_MAX if none
+	std::ostream* output;		// where trace and abort messages go; std::cout unless redirected
+	RunStats* stats;			// counters for --stats; null unless enabled
+	EventTracer* tracer;		// where events go for --trace; null unless enabled
+	void setWaiting(const Task &task);
+	void resetTaskCounters();
+	void resetWaitQueues();
+	void chargeBlockedCycles(Task &task, int through_cycle);
+	void requeueWoken();
+	void insertInOrder(TaskQueue &queue, int id);
 
-	virtual void dispatchInitiate(const Action &action, Task& task) = 0;
-	virtual void dispatchRequest(const Action &action, Task& task) = 0;
-	virtual void dispatchRelease(const Action &action, Task& task) = 0;
-	virtual void dispatchTerminate(const Action &action, Task& task) = 0;
+	template <class Policy> friend class PolicyResourceManager;
 public:
 	ResourceManager(int n_resources, int tasks, int* resources_initial);
-	virtual ~ResourceManager();
+	virtual ~ResourceManager() = default;
 	bool sanityCheck(int i);
 	void reset();
+	virtual void reinitialize(int n_resources, int tasks, int* resources_initial);
 	void incrementCycle();
 	void incrementResourcesAvailable(int i, int amount);
 	void decrementResourcesAvailable(int i, int amount);
 	void commitReleasedResources();
+	long long getUnitsReturned(int i);
+	void setEventDriven(bool enabled);
+	bool isEventDriven();
+	void setOutput(std::ostream &out);
+	std::ostream& getOutput();
+	bool isComputing(const Action &action, Task &task);
+	bool releasedLastCycle();
+	bool hasPendingReleases();
+	int nextWakeupCycle();
+	bool hasTaskDue();
+	void retireTask(Task &task);
+	void deferTask(int id);
+	void startTask(int id);
+	const TaskQueue& getLiveTasks();
+	AllocationMatrix& getAllocations();
+	TaskCounters& getTaskCounters();
+	bool allTasksFinished();
 	int getCycle();
+	long long getDispatchCount();
+	void setStats(RunStats* run_stats);
+	RunStats* getStats();
+	void setTracer(EventTracer* event_tracer);
+	EventTracer* getTracer();
+	int getTotalResources(int i);
 	int getResourcesAvailable(int i);
+	const int* getResourcesAvailableArray();
 	int getResourcesChanged(int i);
+	const int* getWaitingResources();
+	const int* getWaitingAmounts();
 	int getNumResources();
-	virtual void dispatchAction(Task& task) = 0;
+	int getNumTasks();
+};
+
+// The largest number of resource types that gets a variant of the cycle loop of its own, with the count fixed
+#define MAX_FIXED_RESOURCES 4
+
+// PolicyResourceManager is the cycle loop of a resource manager, with the manager deriving from it as its policy.
+// The policy's dispatchAction<N> and uses_wait_queues are bound at compile time instead of through virtual calls.
+// N is the number of resource types if fixed at compile time, or 0. Defined in policy_manager.h
+template <class Policy>
+class PolicyResourceManager : public ResourceManager
+{
+	template <int N> void dispatchBlockedQueue(taskvec_t &task_list);
+	template <int N> void dispatchByResource(taskvec_t &task_list);
+	template <int N> void dispatchChangedWaiters(taskvec_t &task_list);
+	template <int N> void dispatchWaiters(int resource_id, taskvec_t &task_list);
+	template <int N> void dispatchTask(Task &task);
+protected:
+	template <int N> int resourceCount();
+public:
+	PolicyResourceManager(int n_resources, int tasks, int* resources_initial);
+	void skipToCycle(int next_cycle, taskvec_t &task_list);
+	template <int N> void dispatchCycle(taskvec_t &task_list);
+	template <int N> void dispatchRunnable(Task &task);
+	template <int N> void retryBlocked(taskvec_t &task_list, std::vector<int> &woken);
 };
 
 // OptimisticResourceManager dispatches actions on tasks according to resource manager. Obeys FIFO rule - first action to become blocked gets checked first
 // to see if a request can be satisfied. Also, there's a handleDeadlock function that takes action if detectDeadlock returns true. Also, canSatisfyAnyRequest is
 // the criteria for deadlock being resolved.
-class OptimisticResourceManager : public ResourceManager
+class OptimisticResourceManager : public PolicyResourceManager<OptimisticResourceManager>
 {
+	std::vector<int> pending_available;
+	std::vector<int> waiter_start, waiter_ids, waiter_min, waiter_cursor;	// scratch space for resolveDeadlock
 	void dispatchInitiate(const Action &action, Task& task);
 	void dispatchRequest(const Action &action, Task& task);
 	void dispatchRelease(const Action &action, Task& task);
 	void dispatchTerminate(const Action &action, Task& task);
-	bool detectDeadlock(taskvec_t &tasklist);
+	bool detectDeadlock();
+	void abortForDeadlock(Task &task);
+	int countDeadlockVictims();
 public:
 	OptimisticResourceManager(int num_resources, int tasks, int* resources_initial);
 	~OptimisticResourceManager() = default;
-	void dispatchAction(Task& task);
+	void reinitialize(int n_resources, int tasks, int* resources_initial);
+	static const bool uses_wait_queues = true;
+	template <int N> void dispatchAction(Task& task);
 	bool handleDeadlock(taskvec_t &tasklist);
-	bool canSatisfyAnyRequest(taskvec_t &tasklist);
+	bool canSatisfyAnyRequest();
+	int resolveDeadlock(taskvec_t &tasklist);
 };
 
+// Per resource, the live tasks' (need, task id) pairs, kept sorted as needs change
+typedef std::set<std::pair<int, int> > need_order_t;
+
 // BankerResourceManager likewise dispatches actions on tasks according to Banker's algorithm
 // The interesting work happens in dispatchRequest (that's where we check if state is safe)
-class BankerResourceManager : public ResourceManager
+// For every resource, the manager keeps the live tasks sorted by need (from the AllocationMatrix).
+// Those orderings are updated incrementally on grants and releases, so a full safety check over all
+// live tasks is at most a single O(tasks * resources) sweep instead of the quadratic textbook search
+class BankerResourceManager : public PolicyResourceManager<BankerResourceManager>
 {
+	std::vector<need_order_t> need_order;
+	std::vector<int> order_available;				// units available as of the last time short_count caught up
+	std::vector<int> short_count;					// per live task, how many resources it needs more of than that
+	TaskQueue ready_tasks;							// live tasks that aren't short of anything
+	std::vector<bool> retired;						// terminated or aborted tasks are out of the safety check
+	std::vector<int> refusal_epoch;					// claims_epoch when a task's current request was found unsafe, or -1
+	std::vector<int> refusal_retires;				// retire count at which that refusal has to be checked again
+	std::vector<std::vector<std::pair<int, long long> > > refusal_blockers;	// (resource, units returned) likewise
+	std::vector<int> work, missing, missing_check, finish_queue;	// scratch space for isSafeAfterGrant
+	std::vector<need_order_t::const_iterator> order_pos;
+	std::vector<int> order_pos_check;				// the check each order_pos was last set for
+	int live_count, retire_count, check_count, claims_epoch;
+	bool known_safe;								// the state, counting uncommitted releases as back, is safe
+	bool pending_safe;								// the state as it is, while releases are uncommitted, is safe
+	bool claims_against_total;						// a claim is held to every unit, not just those free now
+
 	void dispatchInitiate(const Action &action, Task& task);
-	void dispatchRequest(const Action &action, Task& task);
+	template <int N> void dispatchRequest(const Action &action, Task& task);
 	void dispatchRelease(const Action &action, Task& task);
 	void dispatchTerminate(const Action &action, Task& task);
 	bool detectDeadlock(taskvec_t &tasklist);
+	void unlinkNeed(int task_id, int resource_id);
+	void linkNeed(int task_id, int resource_id);
+	void retire(int task_id);
+	void addShort(int task_id, int delta);
+	void catchUpOrders();
+	int& missingFor(int task_id);
+	bool refusalStillHolds(int task_id);
+	void recordRefusal(int task_id, int resource_id, int amount);
+	template <int N> bool canFinishAfterGrant(int task_id, int resource_id, int amount);
+	template <int N> bool requesterFits(const int* task_need, int resource_id, int amount);
+	template <int N> bool isSafeAfterGrant(int task_id, int resource_id, int amount);
+	void returnToWork(int resource_id, int units, int skip_task);
+	void resetBankerState();
 public:
 	BankerResourceManager(int num_resources, int tasks, int* resources_initial);
 	~BankerResourceManager() = default;
-	void dispatchAction(Task& task);
+	void reinitialize(int n_resources, int tasks, int* resources_initial);
+	void setClaimsAgainstTotal(bool enabled);
+	static const bool uses_wait_queues = false;
+	template <int N> void dispatchAction(Task& task);
 	bool handleDeadlock(taskvec_t &tasklist);
 	bool canSatisfyAnyRequest(taskvec_t &tasklist);
 };
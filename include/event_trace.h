@@ -0,0 +1,89 @@
+/*
+ * event_trace.h
+ *
+ * Runtime event tracing (--trace). A manager hands fixed-size binary records to an EventTracer, which puts
+ * them in a single-producer, single-consumer lock-free ring buffer; a flusher thread drains the ring to a file.
+ * Only the manager's own thread records into its tracer, so the only synchronization is the two indexes.
+ * When the ring is full the manager waits for the flusher, so no event is ever dropped.
+ *
+ * "ResourceAllocator decode" renders trace files in the text the managers used to print in DEBUG builds.
+ *
+ * File layout (native byte order): EventTraceHeader, then TraceEvent records until the end of the file
+ */
+
+#ifndef INCLUDE_EVENT_TRACE_H_
+#define INCLUDE_EVENT_TRACE_H_
+
+#include <atomic>
+#include <iosfwd>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define EVENT_TRACE_MAGIC "RAEVENTS"
+#define EVENT_TRACE_VERSION 1
+
+// How many records the ring holds; a power of two
+#define EVENT_RING_SIZE (1 << 16)
+
+enum trace_event_t
+{
+	TRACE_CYCLE,			// a cycle starts
+	TRACE_SKIP,				// idle cycles skipped up to extra
+	TRACE_INITIATE,			// claim of amount of resource
+	TRACE_COMPUTING,		// amount of extra cycles of delay done
+	TRACE_DELAYED,			// same, for a Banker request
+	TRACE_REFUSED,			// request could not be granted
+	TRACE_GRANTED,			// amount of resource granted; extra is what the task now holds
+	TRACE_RELEASED,			// amount of resource released; extra is what the task now holds
+	TRACE_TERMINATED,
+	TRACE_DEADLOCK_ABORT,	// aborted to break a deadlock; followed by a TRACE_ABORT_RELEASE per resource held
+	TRACE_ABORT_RELEASE,	// amount of resource released by an aborted task
+	TRACE_CLAIM_ABORT,		// Banker: claim (amount) of resource exceeds the units present (extra)
+	TRACE_REQUEST_ABORT		// Banker: request exceeds the task's claim
+};
+
+enum trace_manager_t { TRACE_FIFO, TRACE_BANKER };
+
+struct EventTraceHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t record_size;
+	uint32_t manager;
+	uint32_t reserved;
+};
+
+struct TraceEvent
+{
+	int32_t cycle, task, type, resource, amount, extra;
+};
+
+class EventTracer
+{
+	std::vector<TraceEvent> ring;
+	std::atomic<uint64_t> head;		// next record to write; only the manager's thread moves it
+	std::atomic<uint64_t> tail;		// next record to flush; only the flusher moves it
+	std::atomic<bool> stopping;
+	std::atomic<bool> failed;
+	FILE* file;
+	std::thread flusher;
+
+	EventTracer(const EventTracer &other);
+	EventTracer &operator=(const EventTracer &other);
+	void flushLoop();
+public:
+	EventTracer();
+	~EventTracer();
+	bool open(const std::string &filename, trace_manager_t manager);
+	void record(int cycle, trace_event_t type, int task, int resource, int amount, int extra);
+	bool close();
+	bool hasFailed() const;
+};
+
+// Print the events of each trace file as text, in order. Returns false if a file can't be read
+bool decodeEventTraces(const std::vector<std::string> &filenames, std::ostream &out);
+
+#endif /* INCLUDE_EVENT_TRACE_H_ */
@@ -0,0 +1,63 @@
+/*
+ * online_allocator.h
+ *
+ * OnlineAllocator runs one resource manager (FIFO or Banker) on actions as they arrive, instead of a whole
+ * input through the cycle loop. Each action is dispatched as soon as it comes in, with the manager's usual
+ * rules, and its decision is returned right away. A tick ends the current cycle the way the cycle loop does:
+ * FIFO resolves a deadlock if every live task is blocked, released units are committed (until then they
+ * can't be granted), and blocked requests are tried again in the order they blocked. With FIFO a task only
+ * counts as live from its first action on, so tasks that are never used don't hide a deadlock among the rest.
+ * Unlike an input file, a task may initiate after others hold units, so the Banker checks a claim against
+ * every unit of the resource rather than the units free. A claim can't be lowered below what the task holds.
+ *
+ * The allocator is sized for a fixed number of tasks, like an input file. A task that has terminated or was
+ * aborted stays that way until reset(). Ids are 0-based. Not thread-safe: one thread drives it.
+ * EmbeddedAllocator (resalloc.h) is the public face of it in libresalloc.a
+ */
+
+#ifndef INCLUDE_ONLINE_ALLOCATOR_H_
+#define INCLUDE_ONLINE_ALLOCATOR_H_
+
+#include <ostream>
+#include <vector>
+#include "data_types.h"
+#include "resalloc.h"
+
+class OnlineAllocator
+{
+	bool banker;
+	OptimisticResourceManager optimistic_manager;
+	BankerResourceManager banker_manager;
+	ResourceManager* manager;		// whichever of the two is in use
+	taskvec_t tasks;
+	std::vector<Action> pending;	// each task's action stream is its one action here
+	std::vector<int> units;
+	std::vector<bool> started;		// FIFO: the task has sent an action, so it counts as live
+	std::vector<int> live_ids;		// scratch space for tick
+	std::ostream discard;			// the managers' messages go nowhere
+	const char* last_error;
+
+	bool checkTask(int task_id);
+	bool checkResource(int resource_id);
+	decision_t dispatch(const Action &action);
+	void dispatchRunnable(Task &task);
+	void retryBlocked(std::vector<int> &woken);
+	OnlineAllocator(const OnlineAllocator &other);
+	OnlineAllocator &operator=(const OnlineAllocator &other);
+public:
+	OnlineAllocator(bool use_banker, int num_tasks, const std::vector<int> &resource_units);
+	void reset(int num_tasks);
+	decision_t initiate(int task_id, int resource_id, int claim);
+	decision_t request(int task_id, int resource_id, int amount);
+	decision_t release(int task_id, int resource_id, int amount);
+	decision_t terminate(int task_id);
+	int tick(std::vector<int> &granted, std::vector<int> &aborted);
+	int getCycle();
+	int getNumTasks();
+	int getNumResources();
+	int getNumBlocked();
+	bool isBanker();
+	const char* getLastError();
+};
+
+#endif /* INCLUDE_ONLINE_ALLOCATOR_H_ */
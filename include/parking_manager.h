@@ -0,0 +1,383 @@
+/*
+ * parking_manager.h
+ *
+ * ParkingManager is what ConcurrentResourceManager and ShardedResourceManager share: a slot per task, the wait
+ * lists that refused requests park on, granting waiters in the order they parked, aborting the lowest numbered
+ * parked task until some waiter can go on, and the counts and checks the benchmarks read. The manager derives
+ * from it as its policy, as with PolicyResourceManager, and says where each resource's units, lock and wait list
+ * live and how live and parked tasks are counted. The policy's hooks are bound at compile time:
+ *
+ *   std::mutex &lockOf(int resource_id)			the lock that guards the resource's wait list
+ *   WaitList &waitListOf(int resource_id)
+ *   int unitsAvailable(int resource_id)			with the resource's lock held
+ *   bool takeUnits(int resource_id, int amount)	take the units if there are enough, with the lock held
+ *   void giveBack(int resource_id, int amount)		return units and grant the waiters that fit now
+ *   int getAvailable(int resource_id)				for checkConservation
+ *   void countStarted()							a task became live (deadlock_lock held)
+ *   bool countParked(int resource_id)				a task parked (lock held); true if a deadlock check is due
+ *   void countWoken(int resource_id)				a waiter was granted (lock held)
+ *   void countAborted(int resource_id)				a parked task was aborted (lock held)
+ *   bool countEnded()								a task terminated; true if a deadlock check is due
+ *   bool allParked()								every live task is parked (deadlock_lock held)
+ */
+
+#ifndef INCLUDE_PARKING_MANAGER_H_
+#define INCLUDE_PARKING_MANAGER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+#include "resalloc.h"
+
+template <class Policy>
+class ParkingManager
+{
+protected:
+	enum task_state_t { TASK_IDLE, TASK_RUNNING, TASK_PARKED, TASK_DONE, TASK_ABORTED };
+
+	// A task's fields are only written by its own thread, except state, next and wakeup, which are guarded by
+	// the lock of the resource it's parked on, and held, which a deadlock resolver empties while it's parked
+	struct TaskSlot
+	{
+		std::atomic<int> state;
+		std::atomic<int> resource;		// the request it's parked on
+		int amount;
+		int next;
+		std::condition_variable wakeup;
+		std::vector<int> held;
+		long long grants, blocks;
+	};
+
+	// A resource's parked tasks in the order they parked, linked through TaskSlot::next
+	struct WaitList
+	{
+		int head, tail;
+	};
+
+	int num_resources;
+	std::vector<int> totals;
+	std::vector<std::unique_ptr<TaskSlot> > tasks;
+	std::atomic<long long> aborts;
+	std::mutex deadlock_lock;			// one thread resolves a deadlock at a time, and no task starts meanwhile
+	std::function<void(int)> abort_observer;
+
+	ParkingManager(int num_tasks, const std::vector<int> &units);
+	Policy &policy();
+	bool validAction(int task_id, int resource_id);
+	void grant(int task_id, int resource_id, int amount);
+	decision_t park(std::unique_lock<std::mutex> &guard, int task_id, int resource_id, int amount);
+	void wakeWaiters(int resource_id);
+	void unlink(WaitList &list, int task_id, int previous);
+	void giveBackAll(TaskSlot &task);
+	void resolveDeadlock();
+	bool abortParked(int task_id);
+public:
+	// A task takes part in deadlock detection from start() until it terminates or is aborted. Waits while a
+	// deadlock is being resolved
+	bool start(int task_id);
+	decision_t release(int task_id, int resource_id, int amount);
+	// Releases whatever the task still holds
+	decision_t terminate(int task_id);
+
+	bool isAborted(int task_id) const;
+	int getHeld(int task_id, int resource_id) const;
+	long long getGrants() const;
+	long long getBlocks() const;
+	long long getAborts() const;
+	// Only meaningful while no thread is using the manager: for every resource, units held plus units available
+	// must add up to the total. Reports any resource where they don't and returns false
+	bool checkConservation(std::ostream &out);
+	// Called with the victim's id as each task is aborted, before anything it holds is given back, so a test can
+	// check that the abort was due. Only set it while no thread is using the manager
+	void setAbortObserver(const std::function<void(int task_id)> &observer);
+};
+
+// Task slots are allocated one by one, like the pool's worker queues, so threads working on different tasks
+// mostly don't share cache lines
+template <class Policy>
+ParkingManager<Policy>::ParkingManager(int num_tasks, const std::vector<int> &units) :
+	num_resources(units.size()), totals(units), aborts(0)
+{
+	for (int i = 0; i < num_tasks; i++)
+	{
+		std::unique_ptr<TaskSlot> task(new TaskSlot());
+		task->state = TASK_IDLE;
+		task->resource = 0;
+		task->amount = 0;
+		task->next = -1;
+		task->held.assign(num_resources, 0);
+		task->grants = task->blocks = 0;
+		tasks.push_back(std::move(task));
+	}
+}
+
+template <class Policy>
+Policy &ParkingManager<Policy>::policy()
+{
+	return static_cast<Policy&>(*this);
+}
+
+// Starting waits for the deadlock lock, so a task aborted to break a deadlock can't be running again before the
+// resolver decides on the next victim: every task it aborts was parked along with every other live task
+template <class Policy>
+bool ParkingManager<Policy>::start(int task_id)
+{
+	if (task_id < 0 || task_id >= (int)tasks.size())
+		return false;
+	int state = tasks[task_id]->state.load();
+	if (state == TASK_RUNNING || state == TASK_PARKED)
+		return false;
+	std::lock_guard<std::mutex> guard(deadlock_lock);
+	tasks[task_id]->state = TASK_RUNNING;
+	policy().countStarted();
+	return true;
+}
+
+template <class Policy>
+bool ParkingManager<Policy>::validAction(int task_id, int resource_id)
+{
+	return task_id >= 0 && task_id < (int)tasks.size() && tasks[task_id]->state.load() == TASK_RUNNING
+			&& resource_id >= 0 && resource_id < num_resources;
+}
+
+template <class Policy>
+void ParkingManager<Policy>::grant(int task_id, int resource_id, int amount)
+{
+	tasks[task_id]->held[resource_id] += amount;
+	tasks[task_id]->grants++;
+}
+
+// Join the resource's wait list, with its lock held, and sleep until a release grants the request or a deadlock
+// aborts the task
+template <class Policy>
+decision_t ParkingManager<Policy>::park(std::unique_lock<std::mutex> &guard, int task_id, int resource_id,
+		int amount)
+{
+	TaskSlot &task = *tasks[task_id];
+	WaitList &list = policy().waitListOf(resource_id);
+	task.resource = resource_id;
+	task.amount = amount;
+	task.next = -1;
+	if (list.tail >= 0)
+		tasks[list.tail]->next = task_id;
+	else
+		list.head = task_id;
+	list.tail = task_id;
+	task.state = TASK_PARKED;
+	task.blocks++;
+	bool check_deadlock = policy().countParked(resource_id);
+	guard.unlock();
+
+	if (check_deadlock)
+		resolveDeadlock();
+
+	guard.lock();
+	while (task.state.load() == TASK_PARKED)
+	{
+		task.wakeup.wait(guard);
+	}
+	if (task.state.load() == TASK_ABORTED)
+		return DECISION_ABORTED;
+	guard.unlock();
+	grant(task_id, resource_id, amount);
+	return DECISION_GRANTED;
+}
+
+// Grant every waiter that fits now, in the order they parked. Called with the resource's lock held
+template <class Policy>
+void ParkingManager<Policy>::wakeWaiters(int resource_id)
+{
+	WaitList &list = policy().waitListOf(resource_id);
+	int previous = -1;
+	for (int id = list.head; id >= 0 && policy().unitsAvailable(resource_id) > 0; )
+	{
+		TaskSlot &waiter = *tasks[id];
+		int next = waiter.next;
+		if (policy().takeUnits(resource_id, waiter.amount))
+		{
+			unlink(list, id, previous);
+			policy().countWoken(resource_id);
+			waiter.state = TASK_RUNNING;
+			waiter.wakeup.notify_one();
+		}
+		else
+		{
+			previous = id;
+		}
+		id = next;
+	}
+}
+
+template <class Policy>
+void ParkingManager<Policy>::unlink(WaitList &list, int task_id, int previous)
+{
+	int next = tasks[task_id]->next;
+	if (previous >= 0)
+		tasks[previous]->next = next;
+	else
+		list.head = next;
+	if (list.tail == task_id)
+		list.tail = previous;
+}
+
+template <class Policy>
+void ParkingManager<Policy>::giveBackAll(TaskSlot &task)
+{
+	for (int i = 0; i < num_resources; i++)
+	{
+		if (task.held[i] > 0)
+		{
+			int held = task.held[i];
+			task.held[i] = 0;
+			policy().giveBack(i, held);
+		}
+	}
+}
+
+template <class Policy>
+decision_t ParkingManager<Policy>::release(int task_id, int resource_id, int amount)
+{
+	if (!validAction(task_id, resource_id) || amount < 0 || amount > tasks[task_id]->held[resource_id])
+		return DECISION_INVALID;
+	tasks[task_id]->held[resource_id] -= amount;
+	policy().giveBack(resource_id, amount);
+	return DECISION_OK;
+}
+
+// A task that ends can leave every other live task parked, so it checks for a deadlock on its way out
+template <class Policy>
+decision_t ParkingManager<Policy>::terminate(int task_id)
+{
+	if (!validAction(task_id, 0))
+		return DECISION_INVALID;
+	giveBackAll(*tasks[task_id]);
+	tasks[task_id]->state = TASK_DONE;
+	if (policy().countEnded())
+		resolveDeadlock();
+	return DECISION_OK;
+}
+
+// Every live task is parked: abort the lowest numbered one and release what it holds, until a waiter is granted
+template <class Policy>
+void ParkingManager<Policy>::resolveDeadlock()
+{
+	std::lock_guard<std::mutex> guard(deadlock_lock);
+	while (policy().allParked())
+	{
+		bool aborted = false;
+		for (int id = 0; id < (int)tasks.size() && !aborted; id++)
+		{
+			if (tasks[id]->state.load() == TASK_PARKED)
+				aborted = abortParked(id);
+		}
+		if (!aborted)
+			break;
+	}
+}
+
+// Take the task off its wait list first, so the units it gives back can't be granted to itself. It stays
+// asleep (still TASK_PARKED) until they have been released
+template <class Policy>
+bool ParkingManager<Policy>::abortParked(int task_id)
+{
+	TaskSlot &victim = *tasks[task_id];
+	int resource_id = victim.resource.load();
+	{
+		// It may have been granted, and parked on another resource, since it was seen parked
+		std::lock_guard<std::mutex> guard(policy().lockOf(resource_id));
+		if (victim.state.load() != TASK_PARKED || victim.resource.load() != resource_id)
+			return false;
+		WaitList &list = policy().waitListOf(resource_id);
+		int previous = -1;
+		for (int id = list.head; id != task_id; id = tasks[id]->next)
+		{
+			previous = id;
+		}
+		unlink(list, task_id, previous);
+		if (abort_observer)
+			abort_observer(task_id);
+		policy().countAborted(resource_id);
+	}
+	aborts++;
+
+	giveBackAll(victim);
+
+	std::lock_guard<std::mutex> guard(policy().lockOf(resource_id));
+	victim.state = TASK_ABORTED;
+	victim.wakeup.notify_one();
+	return true;
+}
+
+template <class Policy>
+bool ParkingManager<Policy>::isAborted(int task_id) const
+{
+	return tasks[task_id]->state.load() == TASK_ABORTED;
+}
+
+template <class Policy>
+int ParkingManager<Policy>::getHeld(int task_id, int resource_id) const
+{
+	return tasks[task_id]->held[resource_id];
+}
+
+template <class Policy>
+long long ParkingManager<Policy>::getGrants() const
+{
+	long long grants = 0;
+	for (unsigned int i = 0; i < tasks.size(); i++)
+	{
+		grants += tasks[i]->grants;
+	}
+	return grants;
+}
+
+template <class Policy>
+long long ParkingManager<Policy>::getBlocks() const
+{
+	long long blocks = 0;
+	for (unsigned int i = 0; i < tasks.size(); i++)
+	{
+		blocks += tasks[i]->blocks;
+	}
+	return blocks;
+}
+
+template <class Policy>
+long long ParkingManager<Policy>::getAborts() const
+{
+	return aborts.load();
+}
+
+template <class Policy>
+bool ParkingManager<Policy>::checkConservation(std::ostream &out)
+{
+	bool ok = true;
+	for (int r = 0; r < num_resources; r++)
+	{
+		long long held = 0;
+		for (unsigned int t = 0; t < tasks.size(); t++)
+		{
+			held += tasks[t]->held[r];
+		}
+		int available = policy().getAvailable(r);
+		if (available < 0 || held + available != totals[r])
+		{
+			out << "Resource " << r + 1 << ": " << held << " held + " << available << " available != "
+					<< totals[r] << " units\n";
+			ok = false;
+		}
+	}
+	return ok;
+}
+
+template <class Policy>
+void ParkingManager<Policy>::setAbortObserver(const std::function<void(int task_id)> &observer)
+{
+	abort_observer = observer;
+}
+
+#endif /* INCLUDE_PARKING_MANAGER_H_ */
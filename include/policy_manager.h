@@ -0,0 +1,255 @@
+/*
+ * policy_manager.h
+ *
+ * The cycle loop shared by both resource managers, as PolicyResourceManager<Policy> (declared in data_types.h).
+ * The manager deriving from it is its policy: it supplies dispatchAction<N>, which handles one task's current
+ * action, and uses_wait_queues, which picks the dispatch order. Both are bound at compile time, so the loop
+ * calls straight into the manager's handlers with no virtual call per task per cycle.
+ *
+ * N is the number of resource types when it is known at compile time (1 to MAX_FIXED_RESOURCES), so a policy
+ * can fully unroll its loops over resources, or 0 when it is only known at runtime. The definitions are only
+ * included by the managers' own files, which explicitly instantiate the variants Simulation runs.
+ */
+
+#ifndef INCLUDE_POLICY_MANAGER_H_
+#define INCLUDE_POLICY_MANAGER_H_
+
+#include <algorithm>
+#include <assert.h>
+#include <limits.h>
+#include "data_types.h"
+#include "run_stats.h"
+
+template <class Policy>
+PolicyResourceManager<Policy>::PolicyResourceManager(int n_resources, int tasks, int* resources_initial) :
+	ResourceManager(n_resources, tasks, resources_initial)
+{
+}
+
+// The number of resource types: a constant in the fixed-count variants, so loops bounded by it unroll
+template <class Policy>
+template <int N>
+inline int PolicyResourceManager<Policy>::resourceCount()
+{
+	return N > 0 ? N : getNumResources();
+}
+
+// Jump the clock forward over cycles in which nothing can change. Blocked tasks are charged for the skipped
+// cycles as if they had been dispatched each cycle; with wait queues that happens when the task is next looked at
+template <class Policy>
+void PolicyResourceManager<Policy>::skipToCycle(int next_cycle, taskvec_t &task_list)
+{
+	assert (next_cycle >= cycle);
+	if (!Policy::uses_wait_queues)
+	{
+		for (int id = blocked_queue.front(); id >= 0; id = blocked_queue.nextOf(id))
+		{
+			task_list[id].addTimeBlocked(next_cycle - cycle);
+		}
+	}
+	cycle = next_cycle;
+}
+
+// Process each task's action for this cycle. Blocked tasks go first, in the order they were blocked (FIFO);
+// tasks blocked in the same cycle were queued in id order. Then every other live task goes, in id order.
+// The task list itself stays in id order, so task_list[id] is the task with that id
+template <class Policy>
+template <int N>
+void PolicyResourceManager<Policy>::dispatchCycle(taskvec_t &task_list)
+{
+	if (Policy::uses_wait_queues)
+	{
+		dispatchByResource<N>(task_list);
+		return;
+	}
+
+	dispatchBlockedQueue<N>(task_list);
+
+	// Tasks that were blocked at the start of the cycle have already had their turn
+	int next_id = -1;
+	for (int id = live_tasks.front(); id >= 0; id = next_id)
+	{
+		next_id = live_tasks.nextOf(id);
+		if (blocked_queue.contains(id) || woken_tasks.contains(id))
+			continue;
+
+		dispatchRunnable<N>(task_list[id]);
+	}
+	woken_tasks.clear();
+}
+
+// Give every blocked task another try, in the order they were blocked. Tasks that get through are moved to
+// woken_tasks, so they aren't dispatched again this cycle
+template <class Policy>
+template <int N>
+void PolicyResourceManager<Policy>::dispatchBlockedQueue(taskvec_t &task_list)
+{
+	int next_id = -1;
+	for (int id = blocked_queue.front(); id >= 0; id = next_id)
+	{
+		next_id = blocked_queue.nextOf(id);
+		Task &task = task_list[id];
+		dispatchTask<N>(task);
+		if (!task.isBlocked() && !task.isDoneOrAborted())
+		{
+			blocked_queue.remove(id);
+			woken_tasks.pushBack(id);
+			setWaiting(task);
+		}
+	}
+}
+
+// Same order and outcome as dispatchCycle, without visiting every blocked task every cycle. Units only come
+// back at the end of a cycle, so a waiter refused last cycle is refused again unless its resource had units
+// released. Only those resources' queues are walked, each in FIFO order; waits on different resources don't
+// affect each other, so it doesn't matter which queue goes first. Then the runnable tasks go, in id order.
+// Time blocked is charged lazily, when the waiter is next dispatched or retired
+template <class Policy>
+template <int N>
+void PolicyResourceManager<Policy>::dispatchByResource(taskvec_t &task_list)
+{
+	dispatchChangedWaiters<N>(task_list);
+
+	int next_id = -1;
+	for (int id = runnable_tasks.front(); id >= 0; id = next_id)
+	{
+		next_id = runnable_tasks.nextOf(id);
+		dispatchRunnable<N>(task_list[id]);
+	}
+
+	// Tasks woken this cycle run from the next cycle on
+	requeueWoken();
+}
+
+// Walk the wait queues of the resources that had units released at the last commit. Woken tasks are
+// collected in woken_ids
+template <class Policy>
+template <int N>
+void PolicyResourceManager<Policy>::dispatchChangedWaiters(taskvec_t &task_list)
+{
+	woken_ids.clear();
+	for (unsigned int i = 0; i < changed_resources.size(); i++)
+	{
+		dispatchWaiters<N>(changed_resources[i], task_list);
+	}
+	changed_resources.clear();
+}
+
+// Walk the waiters on one resource, in the order they blocked, stopping once the resource runs out. Waiters
+// asking for more than is left are passed over without being dispatched; they would only be refused.
+// Recomputes the smallest request still waiting, if the whole queue was walked
+template <class Policy>
+template <int N>
+void PolicyResourceManager<Policy>::dispatchWaiters(int resource_id, taskvec_t &task_list)
+{
+	if (wait_queues.getMinAmount(resource_id) > resources_available[resource_id])
+		return;
+
+	int min_amount = INT_MAX;
+	int next_id = -1;
+	for (int id = wait_queues.front(resource_id); id >= 0; id = next_id)
+	{
+		next_id = wait_queues.nextOf(id);
+		if (waiting_amount[id] > resources_available[resource_id])
+		{
+			min_amount = std::min(min_amount, waiting_amount[id]);
+			continue;
+		}
+
+		Task &task = task_list[id];
+		chargeBlockedCycles(task, cycle - 1);
+		dispatchTask<N>(task);
+		if (task.isBlocked())
+		{
+			blocked_charged[id] = cycle;
+			min_amount = std::min(min_amount, waiting_amount[id]);
+		}
+		else if (!task.isDoneOrAborted())
+		{
+			wait_queues.remove(id);
+			woken_ids.push_back(id);
+			setWaiting(task);
+		}
+	}
+	if (wait_queues.front(resource_id) >= 0)
+	{
+		wait_queues.setMinAmount(resource_id, min_amount);
+	}
+}
+
+// Dispatch a task that isn't blocked, and queue it as blocked if it was refused. Also used by OnlineAllocator
+// to dispatch one action as soon as it arrives
+template <class Policy>
+template <int N>
+void PolicyResourceManager<Policy>::dispatchRunnable(Task &task)
+{
+	dispatchTask<N>(task);
+	if (!task.isBlocked())
+		return;
+
+	int id = task.getId();
+	if (Policy::uses_wait_queues)
+	{
+		runnable_tasks.remove(id);
+		wait_queues.pushBack(id, task.getActionPointer()->getResourceId(), task.getActionPointer()->getAmount());
+		blocked_charged[id] = cycle;
+	}
+	else
+	{
+		blocked_queue.pushBack(id);
+	}
+	setWaiting(task);
+}
+
+// For OnlineAllocator, where actions arrive one at a time instead of a cycle's worth: give blocked tasks
+// another try, as at the start of a cycle, and append the ids of those that got through to woken
+template <class Policy>
+template <int N>
+void PolicyResourceManager<Policy>::retryBlocked(taskvec_t &task_list, std::vector<int> &woken)
+{
+	if (Policy::uses_wait_queues)
+	{
+		dispatchChangedWaiters<N>(task_list);
+		woken.insert(woken.end(), woken_ids.begin(), woken_ids.end());
+		requeueWoken();
+		return;
+	}
+
+	dispatchBlockedQueue<N>(task_list);
+	for (int id = woken_tasks.front(); id >= 0; id = woken_tasks.nextOf(id))
+	{
+		woken.push_back(id);
+	}
+	woken_tasks.clear();
+}
+
+// Dispatch the task's action and handle blocking (by updating time blocked). The policy's dispatchAction is
+// bound at compile time, so it is a direct call the compiler can inline. Tasks that are computing in
+// event-driven mode are skipped until their wakeup cycle.
+// If the task was successfully dispatched and the delay time has elapsed (or was 0),
+// advance the task's action stream to its next action
+template <class Policy>
+template <int N>
+inline void PolicyResourceManager<Policy>::dispatchTask(Task &task)
+{
+	if (task.getWakeCycle() > cycle)
+		return;
+
+	dispatch_count++;
+	static_cast<Policy*>(this)->template dispatchAction<N>(task);
+	if (task.isBlocked())
+	{
+		task.incrementTimeBlocked();
+	}
+	else if (task.getDelay() == 0)
+	{
+		task.advanceAction();
+	}
+
+	if (task.isDoneOrAborted())
+	{
+		retireTask(task);
+	}
+}
+
+#endif /* INCLUDE_POLICY_MANAGER_H_ */
@@ -0,0 +1,68 @@
+/*
+ * resalloc.h
+ *
+ * Public header of libresalloc.a, the managers built as a library, for a scheduler that wants allocation
+ * decisions in-process instead of from the ResourceAllocator executable or "serve". Only this header is
+ * needed to use it; link with
+ *
+ *   g++ -std=gnu++11 -I<repo>/include app.cpp <repo>/libresalloc.a -pthread
+ *
+ * EmbeddedAllocator decides each action as it is made, with the FIFO (optimistic) or Banker rules of the
+ * simulation, and tick() ends a cycle: FIFO resolves a deadlock, released units become available again, and
+ * blocked requests are retried in the order they blocked. Ids are 0-based. An allocator is not thread-safe;
+ * one thread (or a caller holding a lock) drives it
+ */
+
+#ifndef INCLUDE_RESALLOC_H_
+#define INCLUDE_RESALLOC_H_
+
+#include <vector>
+
+enum decision_t
+{
+	DECISION_OK,		// initiate, release or terminate done
+	DECISION_GRANTED,	// request granted
+	DECISION_BLOCKED,	// request can't be granted yet; the task waits until a tick grants it, or aborts it
+	DECISION_ABORTED,	// the task was aborted (Banker: claim above the units present, or request above the claim)
+	DECISION_INVALID	// see getLastError()
+};
+
+class OnlineAllocator;
+
+class EmbeddedAllocator
+{
+	OnlineAllocator* allocator;		// null until configure() succeeds
+	const char* last_error;
+
+	bool checkConfigured();
+	decision_t decided(decision_t decision);
+	EmbeddedAllocator(const EmbeddedAllocator &other);
+	EmbeddedAllocator &operator=(const EmbeddedAllocator &other);
+public:
+	EmbeddedAllocator();
+	~EmbeddedAllocator();
+
+	// Pick the manager and the units of each resource type, for num_tasks tasks. Returns false (see
+	// getLastError()) if any count isn't positive; an allocator configured before stays as it was
+	bool configure(bool use_banker, int num_tasks, const std::vector<int> &units);
+	// Start a new job with num_tasks tasks and every unit available
+	bool reset(int num_tasks);
+
+	decision_t initiate(int task_id, int resource_id, int claim);
+	decision_t request(int task_id, int resource_id, int amount);
+	// Released units can be granted from the next tick on
+	decision_t release(int task_id, int resource_id, int amount);
+	// Also releases whatever the task still holds
+	decision_t terminate(int task_id);
+	// End the cycle. Appends the tasks whose blocked requests were granted, and those aborted to break a
+	// deadlock. Returns the new cycle, or -1 if the allocator isn't configured
+	int tick(std::vector<int> &granted, std::vector<int> &aborted);
+
+	bool isConfigured() const;
+	int getCycle() const;
+	int getNumTasks() const;
+	int getNumResources() const;
+	const char* getLastError() const;
+};
+
+#endif /* INCLUDE_RESALLOC_H_ */
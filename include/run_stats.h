@@ -0,0 +1,44 @@
+/*
+ * run_stats.h
+ *
+ * Optional instrumentation for one manager's run (--stats): wall time per phase of the cycle loop, and counters
+ * for what the manager did. A manager only updates its stats if it was given a RunStats, so with the flag off
+ * each counter is a null check and each phase timer is a null check at either end.
+ */
+
+#ifndef INCLUDE_RUN_STATS_H_
+#define INCLUDE_RUN_STATS_H_
+
+#include <chrono>
+#include <iosfwd>
+
+enum phase_t { PHASE_DISPATCH, PHASE_DEADLOCK, PHASE_COMMIT, PHASE_SKIP, NUM_PHASES };
+
+struct RunStats
+{
+	long long phase_ns[NUM_PHASES];
+	long long cycles, dispatches;
+	long long grants, blocks, aborts;
+	long long safety_checks, cached_refusals;	// full Banker safety checks, and refusals answered from cache
+	long long deadlocks, deadlock_victims;		// victims are what the old handleDeadlock loop iterated over
+	long long sorts;							// woken-task sorts
+
+	RunStats();
+	void reset();
+};
+
+// Adds the time from construction to destruction to one phase of stats, if there are stats
+class PhaseTimer
+{
+	RunStats* stats;
+	phase_t phase;
+	std::chrono::steady_clock::time_point start;
+public:
+	PhaseTimer(RunStats* run_stats, phase_t timed_phase);
+	~PhaseTimer();
+};
+
+// Both managers' stats as one JSON object, plus the time spent loading the input
+void writeStatsJson(std::ostream &out, const RunStats &optimistic, const RunStats &banker, long long load_ns);
+
+#endif /* INCLUDE_RUN_STATS_H_ */
@@ -0,0 +1,45 @@
+/*
+ * server.h
+ *
+ * "ResourceAllocator serve": an OnlineAllocator behind a Unix domain socket, for a job launcher to ask for
+ * decisions one action at a time. One thread serves every connection from a poll loop, so all clients share
+ * one allocator and their messages are applied in the order they are read.
+ *
+ * The protocol is one line per message and one line per reply. Ids are 1-based, as in input files:
+ *
+ *   initiate <task> <resource> <claim>		ok | abort
+ *   request <task> <resource> <amount>		grant | block | abort
+ *   release <task> <resource> <amount>		ok
+ *   terminate <task>						ok
+ *   tick									tick <cycle> granted <task>... aborted <task>...
+ *   reset [<tasks>]						ok
+ *
+ * Anything that can't be applied gets "error <reason>" instead. A blocked task waits until a tick grants
+ * (or aborts) its request, and units released only come back at the next tick. Terminating releases whatever
+ * the task still holds. "reset" takes at most MAX_SERVE_TASKS tasks. Messages may be pipelined; replies come back
+ * in the same order. A client that sends faster than it reads replies is only read from again once it has taken
+ * most of them, so pipelining never makes the server buffer without bound
+ */
+
+#ifndef INCLUDE_SERVER_H_
+#define INCLUDE_SERVER_H_
+
+#include <string>
+#include <vector>
+
+// Most tasks an allocator can be sized for, by --tasks or "reset", so one message can't make the server
+// allocate a table of any size it likes
+#define MAX_SERVE_TASKS (1 << 16)
+
+struct ServerOptions
+{
+	std::string socket_path;
+	bool banker;
+	int num_tasks;
+	std::vector<int> units;
+};
+
+// Serve until SIGINT or SIGTERM. Returns false if the socket can't be set up
+bool runServer(const ServerOptions &options);
+
+#endif /* INCLUDE_SERVER_H_ */
@@ -0,0 +1,77 @@
+/*
+ * sharded_manager.h
+ *
+ * ShardedResourceManager: the Optimistic (FIFO) manager for many threads and many resource types. Resource ids
+ * are dealt round-robin across shards (resource r lives in shard r % shards), and each shard has its own lock,
+ * units available and per-resource wait lists, so a request or release locks exactly one shard and threads
+ * working on resources in different shards never meet. Each task is driven by one thread at a time.
+ *
+ * As in ConcurrentResourceManager, a request that can't be granted parks until a release in its shard grants
+ * it (waiters are served in the order they parked), released units are available at once, and when every
+ * started task is parked the lowest numbered one is aborted and what it holds released, until some waiter can
+ * go on. Whether every task is parked is decided from the shards' parked counts without locking any shard: each
+ * shard bumps a version whenever its count changes, and the counts are only trusted if no version moved while
+ * they were read. The task slots, wait lists and deadlock resolution are ParkingManager's (parking_manager.h)
+ */
+
+#ifndef INCLUDE_SHARDED_MANAGER_H_
+#define INCLUDE_SHARDED_MANAGER_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "parking_manager.h"
+
+class ShardedResourceManager : public ParkingManager<ShardedResourceManager>
+{
+	// Everything but parked and version is guarded by lock. Resources are indexed by resource id / shards
+	struct Shard
+	{
+		std::mutex lock;
+		std::vector<int> available;
+		std::vector<WaitList> waiting;
+		std::atomic<int> parked;			// written under lock, read without it by the deadlock check
+		std::atomic<unsigned int> version;	// bumped under lock whenever parked changes
+	};
+
+	int num_shards;
+	std::vector<std::unique_ptr<Shard> > shards;
+	std::atomic<int> live;					// started and not done or aborted
+	std::vector<unsigned int> versions;		// scratch space for allParked, under deadlock_lock
+
+	Shard &shardOf(int resource_id);
+	int countParkedTasks();
+	void changeParked(Shard &shard, int delta);
+	decision_t decide(int task_id, int resource_id, int amount, bool wait);
+
+	// ParkingManager's policy
+	std::mutex &lockOf(int resource_id);
+	WaitList &waitListOf(int resource_id);
+	int unitsAvailable(int resource_id);
+	bool takeUnits(int resource_id, int amount);
+	void giveBack(int resource_id, int amount);
+	void countStarted();
+	bool countParked(int resource_id);
+	void countWoken(int resource_id);
+	void countAborted(int resource_id);
+	bool countEnded();
+	bool allParked();
+	friend class ParkingManager<ShardedResourceManager>;
+
+	ShardedResourceManager(const ShardedResourceManager &other);
+	ShardedResourceManager &operator=(const ShardedResourceManager &other);
+public:
+	ShardedResourceManager(int num_tasks, const std::vector<int> &units, int num_shards);
+
+	// Block until the units are granted (DECISION_GRANTED) or the task is aborted to break a deadlock
+	decision_t request(int task_id, int resource_id, int amount);
+	// Never parks: DECISION_GRANTED or DECISION_BLOCKED
+	decision_t tryRequest(int task_id, int resource_id, int amount);
+
+	int getNumShards() const;
+	// Locks the resource's shard
+	int getAvailable(int resource_id);
+};
+
+#endif /* INCLUDE_SHARDED_MANAGER_H_ */
@@ -0,0 +1,55 @@
+/*
+ * simd_kernels.h
+ *
+ * Vectorized kernels for the per-resource checks in the resource managers. Each kernel has an AVX2,
+ * an SSE2 and a scalar version; the best one the CPU supports is picked at runtime on first use.
+ */
+
+#ifndef INCLUDE_SIMD_KERNELS_H_
+#define INCLUDE_SIMD_KERNELS_H_
+
+// True if need[i] <= available[i] for every i in [0, n)
+typedef bool (*all_less_equal_t)(const int* need, const int* available, int n);
+
+// True if amounts[i] <= available[resource_ids[i]] for any i in [0, n)
+typedef bool (*any_satisfiable_t)(const int* amounts, const int* resource_ids, int n, const int* available);
+
+struct SimdKernels
+{
+	const char* name;
+	all_less_equal_t allLessEqual;
+	any_satisfiable_t anySatisfiable;
+};
+
+// The kernels chosen for this CPU
+const SimdKernels& simdKernels();
+
+// Every variant this CPU can run, slowest (scalar) first. Used by the micro-benchmark
+int simdKernelVariants(const SimdKernels** variants, int max_variants);
+
+inline bool simdAllLessEqual(const int* need, const int* available, int n)
+{
+	return simdKernels().allLessEqual(need, available, n);
+}
+
+inline bool simdAnySatisfiable(const int* amounts, const int* resource_ids, int n, const int* available)
+{
+	return simdKernels().anySatisfiable(amounts, resource_ids, n, available);
+}
+
+// simdAllLessEqual for n == N, with N fixed at compile time: for a handful of resources, a loop the compiler
+// unrolls beats a call through the kernel table. N == 0 means n is only known at runtime
+template <int N>
+inline bool fixedAllLessEqual(const int* need, const int* available, int n)
+{
+	if (N == 0)
+		return simdAllLessEqual(need, available, n);
+	bool fits = true;
+	for (int i = 0; i < N; i++)
+	{
+		fits &= need[i] <= available[i];
+	}
+	return fits;
+}
+
+#endif /* INCLUDE_SIMD_KERNELS_H_ */
@@ -0,0 +1,57 @@
+/*
+ * simulation.h
+ *
+ * The cycle loops for the two resource managers, and the per-run results they print. A Simulation owns
+ * one manager of each kind and their task lists, and is reused from one input to the next: prepare()
+ * re-dimensions the managers in place instead of constructing new ones.
+ *
+ * A run can be given a bound on its rank (aborted tasks first, then makespan; see simulationRank). The bound is
+ * read every cycle, so another thread may lower it while the run is going. Once the tasks aborted so far and
+ * the current cycle already rank past the bound, the finished run could only rank worse, so it stops.
+ */
+
+#ifndef INCLUDE_SIMULATION_H_
+#define INCLUDE_SIMULATION_H_
+
+#include <atomic>
+#include <iosfwd>
+#include "binary_trace.h"
+#include "data_types.h"
+
+// Pack aborted tasks and makespan into one key, so that comparing keys compares aborts first
+long long simulationRank(int aborted_tasks, int makespan);
+
+// Totals over the tasks of one run, as printed on its "Total" line, plus how many tasks were aborted
+// and the cycle the last task terminated in. completed is false if the run was stopped at its rank bound,
+// in which case nothing was printed and the totals are meaningless. cycles and dispatches are how far the
+// manager's clock got and how many actions it dispatched, for throughput measurements
+struct SimulationSummary
+{
+	long long total_cycles;
+	long long total_blocked;
+	int aborted_tasks;
+	int makespan;
+	bool completed;
+	int cycles;
+	long long dispatches;
+};
+
+class Simulation
+{
+	OptimisticResourceManager optimistic_manager;
+	BankerResourceManager banker_manager;
+	taskvec_t optimistic_tasks, banker_tasks;
+	template <int N> SimulationSummary runBankerWith(std::ostream &out, const std::atomic<long long>* rank_bound);
+public:
+	Simulation();
+	void setEventDriven(bool enabled);
+	void setStats(RunStats* optimistic_stats, RunStats* banker_stats);
+	void setTracers(EventTracer* optimistic_tracer, EventTracer* banker_tracer);
+	void prepare(int num_tasks, int num_resources, int* resources);
+	void bindStreams(const ActionTable &action_table);
+	void bindStreams(BinaryTraceReader &optimistic_reader, BinaryTraceReader &banker_reader);
+	SimulationSummary runOptimistic(std::ostream &out, const std::atomic<long long>* rank_bound = nullptr);
+	SimulationSummary runBanker(std::ostream &out, const std::atomic<long long>* rank_bound = nullptr);
+};
+
+#endif /* INCLUDE_SIMULATION_H_ */
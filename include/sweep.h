@@ -0,0 +1,33 @@
+/*
+ * sweep.h
+ *
+ * Capacity sweep: re-run one parsed trace under both managers with the resource totals scaled over a grid
+ * of percentages, with the grid points spread across a thread pool.
+ */
+
+#ifndef INCLUDE_SWEEP_H_
+#define INCLUDE_SWEEP_H_
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include "data_types.h"
+
+struct SweepOptions
+{
+	int low, high, step;	// percentages of each resource's units
+	bool each_resource;		// scale every resource independently (a grid) instead of all together
+	bool early_exit;		// stop a point once it can only rank worse than the best so far (aborts, then makespan)
+	int jobs;
+};
+
+// Parse "low:high:step", e.g. "50:200:5". Returns false and fills in error if it's malformed
+bool parseSweepRange(const std::string &spec, SweepOptions &options, std::string &error);
+
+// Run every point of the sweep and print a line per point (makespan, blocked cycles and aborts for each manager),
+// then the best point for each manager: fewest aborts, then shortest makespan, then fewest blocked cycles. With early exit, which points get stopped depends on the order in
+// which the workers finish, so only the best points are deterministic. Returns false if the grid is too large
+bool runSweep(const SweepOptions &options, const std::vector<int> &resources, const ActionTable &action_table,
+		std::ostream &out);
+
+#endif /* INCLUDE_SWEEP_H_ */
@@ -0,0 +1,38 @@
+/*
+ * thread_pool.h
+ *
+ * Work-stealing pool for running many independent jobs (batch inputs, sweep points) across threads.
+ */
+
+#ifndef INCLUDE_THREAD_POOL_H_
+#define INCLUDE_THREAD_POOL_H_
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Runs jobs 0 .. num_jobs - 1 on a fixed number of workers. Jobs are dealt round-robin onto per-worker
+// deques; a worker takes jobs from the front of its own deque and, once that is empty, steals from the
+// back of another worker's. The calling thread is worker 0
+class WorkStealingPool
+{
+	struct WorkerQueue
+	{
+		std::mutex lock;
+		std::deque<int> jobs;
+	};
+	int num_workers;
+	std::vector<std::unique_ptr<WorkerQueue> > queues;
+
+	bool takeLocal(int worker, int &job);
+	bool steal(int worker, int &job);
+	void work(int worker, const std::function<void(int worker, int job)> &job_fn);
+public:
+	WorkStealingPool(int workers);
+	int getNumWorkers() const;
+	void run(int num_jobs, const std::function<void(int worker, int job)> &job_fn);
+};
+
+#endif /* INCLUDE_THREAD_POOL_H_ */
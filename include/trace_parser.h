@@ -0,0 +1,41 @@
+/*
+ * trace_parser.h
+ *
+ * Zero-copy parser for the text input format. The file is memory-mapped and scanned in place:
+ * integers are parsed by hand, keywords are dispatched on their first byte, and nothing is allocated
+ * per token.
+ */
+
+#ifndef INCLUDE_TRACE_PARSER_H_
+#define INCLUDE_TRACE_PARSER_H_
+
+#include <string>
+#include <vector>
+#include "data_types.h"
+
+// Everything in an input file: the header (number of tasks, number of resources and the units of each)
+// and the actions in the order they appear
+struct TraceInput
+{
+	int num_tasks;
+	int num_resources;
+	std::vector<int> resources;
+	actionvec_t actions;
+};
+
+// Where parsing stopped. Lines and columns start at 1
+struct ParseError
+{
+	int line;
+	int column;
+	std::string message;
+};
+
+// Returns false and fills in error if the file can't be read or is malformed. Every task must have actions,
+// and its last one must be terminate
+bool parseTraceFile(const std::string &filename, TraceInput &input, ParseError &error);
+
+// Same, for a buffer that is already in memory
+bool parseTraceBuffer(const char* data, size_t size, TraceInput &input, ParseError &error);
+
+#endif /* INCLUDE_TRACE_PARSER_H_ */
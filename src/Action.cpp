@@ -1,6 +1,6 @@
 #include "data_types.h"
 
-// Constructor, Copy Constructor, and get methods for Action
+// Constructor, Copy Constructor, assignment, and get methods for Action
 
 Action::Action(action_t typ, int t_id, int d, int res_id, int amt)
 {
@@ -20,6 +20,16 @@ Action::Action(const Action &action)
 	amount = action.amount;
 }
 
+Action &Action::operator=(const Action &action)
+{
+	type = action.type;
+	task_id = action.task_id;
+	delay = action.delay;
+	resource_id = action.resource_id;
+	amount = action.amount;
+	return *this;
+}
+
 // Get methods for Action. All are const because Actions are immutable
 action_t Action::getType() const
 {
@@ -0,0 +1,165 @@
+#include "data_types.h"
+#include <assert.h>
+
+// Constructors and methods for ActionStream
+
+ActionStream::ActionStream()
+{
+	next_action = nullptr;
+	end = nullptr;
+	source = nullptr;
+	task_id = -1;
+}
+
+ActionStream::ActionStream(const Action* first, const Action* last)
+{
+	next_action = first;
+	end = last;
+	source = nullptr;
+	task_id = -1;
+}
+
+// Start a stream backed by a source, and pull its first window
+ActionStream::ActionStream(ActionSource* action_source, int id)
+{
+	next_action = nullptr;
+	end = nullptr;
+	source = action_source;
+	task_id = id;
+	source->refill(task_id, *this);
+}
+
+// Returns nullptr once every action has been consumed
+const Action* ActionStream::current() const
+{
+	return exhausted() ? nullptr : next_action;
+}
+
+bool ActionStream::exhausted() const
+{
+	return next_action == end;
+}
+
+// Windows are refilled as soon as they run out, so exhausted() and current() never need the source
+void ActionStream::advance()
+{
+	assert (!exhausted());
+	next_action++;
+	if (next_action == end && source)
+	{
+		source->refill(task_id, *this);
+	}
+}
+
+// Called by the source when it refills the stream. An empty window means there are no actions left
+void ActionStream::setWindow(const Action* first, const Action* last)
+{
+	next_action = first;
+	end = last;
+}
+
+// Drop the rest of the stream, and let the source free the task's window
+void ActionStream::close()
+{
+	next_action = nullptr;
+	end = nullptr;
+	if (source)
+	{
+		source->release(task_id);
+		source = nullptr;
+	}
+}
+
+// Number of actions left in the current window (for streams without a source, in the whole stream)
+int ActionStream::remaining() const
+{
+	return end - next_action;
+}
+
+ActionTable::ActionTable()
+{
+	mapped_actions = nullptr;
+	mapped_offsets = nullptr;
+	num_tasks = 0;
+	num_actions = 0;
+}
+
+// Build the table from the actions in the order they appeared in the input file. A counting sort on
+// task id groups them per task while keeping each task's actions in file order
+ActionTable::ActionTable(int n_tasks, const actionvec_t &file_order_actions)
+{
+	rebuild(n_tasks, file_order_actions);
+}
+
+// Same as the constructor, for a table reused across inputs: the owned arrays keep their storage
+void ActionTable::rebuild(int n_tasks, const actionvec_t &file_order_actions)
+{
+	mapped_actions = nullptr;
+	mapped_offsets = nullptr;
+	num_tasks = n_tasks;
+	num_actions = file_order_actions.size();
+
+	offsets.assign(n_tasks + 1, 0);
+	for (unsigned int i = 0; i < file_order_actions.size(); i++)
+	{
+		assert (sanityCheck(file_order_actions[i].getTaskId()));
+		offsets[file_order_actions[i].getTaskId() + 1]++;
+	}
+	for (int i = 0; i < n_tasks; i++)
+	{
+		offsets[i + 1] += offsets[i];
+	}
+
+	std::vector<int> position(offsets.begin(), offsets.end() - 1);
+	actions.assign(file_order_actions.size(), Action(TERMINATE, 0, 0, 0, 0));
+	for (unsigned int i = 0; i < file_order_actions.size(); i++)
+	{
+		const Action &action = file_order_actions[i];
+		actions[position[action.getTaskId()]++] = action;
+	}
+}
+
+// Borrow actions that are already grouped by task, e.g. the records of a mapped binary trace.
+// Nothing is copied; the caller keeps the arrays alive for as long as the table (and its streams) are used
+ActionTable::ActionTable(int n_tasks, int n_actions, const Action* grouped_actions, const int* task_offsets)
+{
+	mapped_actions = grouped_actions;
+	mapped_offsets = task_offsets;
+	num_tasks = n_tasks;
+	num_actions = n_actions;
+}
+
+// Sanity check for out of bounds array access
+bool ActionTable::sanityCheck(int task_id) const
+{
+	return (task_id >= 0) && (task_id < getNumTasks());
+}
+
+// Owned arrays are looked up on every access rather than cached, so copies of the table stay valid
+const Action* ActionTable::actionData() const
+{
+	return mapped_actions ? mapped_actions : actions.data();
+}
+
+const int* ActionTable::offsetData() const
+{
+	return mapped_offsets ? mapped_offsets : offsets.data();
+}
+
+int ActionTable::getNumTasks() const
+{
+	return num_tasks;
+}
+
+int ActionTable::getNumActions() const
+{
+	return num_actions;
+}
+
+ActionStream ActionTable::getStream(int task_id) const
+{
+	assert (sanityCheck(task_id));
+	const Action* base = actionData();
+	const int* task_offsets = offsetData();
+	return ActionStream(base + task_offsets[task_id], base + task_offsets[task_id + 1]);
+}
@@ -0,0 +1,117 @@
+#include "data_types.h"
+#include <assert.h>
+
+// Constructor and methods for AllocationMatrix. Every update to held or claimed also updates need,
+// in both the task-major and resource-major views
+
+AllocationMatrix::AllocationMatrix(int n_tasks, int n_resources)
+{
+	num_tasks = n_tasks;
+	num_resources = n_resources;
+	held.assign(n_tasks * n_resources, 0);
+	claimed.assign(n_tasks * n_resources, 0);
+	need.assign(n_tasks * n_resources, 0);
+	held_by_resource.assign(n_tasks * n_resources, 0);
+	need_by_resource.assign(n_tasks * n_resources, 0);
+}
+
+void AllocationMatrix::reset()
+{
+	std::fill(held.begin(), held.end(), 0);
+	std::fill(claimed.begin(), claimed.end(), 0);
+	std::fill(need.begin(), need.end(), 0);
+	std::fill(held_by_resource.begin(), held_by_resource.end(), 0);
+	std::fill(need_by_resource.begin(), need_by_resource.end(), 0);
+}
+
+// Zero the matrix for a different number of tasks and resources. assign() keeps the vectors' storage,
+// so a matrix reused for inputs of similar size stops allocating
+void AllocationMatrix::resize(int n_tasks, int n_resources)
+{
+	num_tasks = n_tasks;
+	num_resources = n_resources;
+	held.assign(n_tasks * n_resources, 0);
+	claimed.assign(n_tasks * n_resources, 0);
+	need.assign(n_tasks * n_resources, 0);
+	held_by_resource.assign(n_tasks * n_resources, 0);
+	need_by_resource.assign(n_tasks * n_resources, 0);
+}
+
+// Sanity check for out of bounds array access
+bool AllocationMatrix::sanityCheck(int task_id, int resource_id) const
+{
+	return (task_id >= 0) && (task_id < num_tasks) && (resource_id >= 0) && (resource_id < num_resources);
+}
+
+void AllocationMatrix::setHeld(int task_id, int resource_id, int amount)
+{
+	assert (sanityCheck(task_id, resource_id));
+	int i = task_id * num_resources + resource_id;
+	held[i] = amount;
+	need[i] = claimed[i] - amount;
+	held_by_resource[resource_id * num_tasks + task_id] = amount;
+	need_by_resource[resource_id * num_tasks + task_id] = need[i];
+}
+
+void AllocationMatrix::setClaim(int task_id, int resource_id, int amount)
+{
+	assert (sanityCheck(task_id, resource_id));
+	int i = task_id * num_resources + resource_id;
+	claimed[i] = amount;
+	need[i] = amount - held[i];
+	need_by_resource[resource_id * num_tasks + task_id] = need[i];
+}
+
+int AllocationMatrix::getHeld(int task_id, int resource_id) const
+{
+	assert (sanityCheck(task_id, resource_id));
+	return held[task_id * num_resources + resource_id];
+}
+
+int AllocationMatrix::getClaim(int task_id, int resource_id) const
+{
+	assert (sanityCheck(task_id, resource_id));
+	return claimed[task_id * num_resources + resource_id];
+}
+
+int AllocationMatrix::getNeed(int task_id, int resource_id) const
+{
+	assert (sanityCheck(task_id, resource_id));
+	return need[task_id * num_resources + resource_id];
+}
+
+// Task-major views: one task's values for every resource
+const int* AllocationMatrix::heldRow(int task_id) const
+{
+	assert (sanityCheck(task_id, 0));
+	return &held[task_id * num_resources];
+}
+
+const int* AllocationMatrix::needRow(int task_id) const
+{
+	assert (sanityCheck(task_id, 0));
+	return &need[task_id * num_resources];
+}
+
+// Resource-major views: one resource's values for every task
+const int* AllocationMatrix::heldColumn(int resource_id) const
+{
+	assert (sanityCheck(0, resource_id));
+	return &held_by_resource[resource_id * num_tasks];
+}
+
+const int* AllocationMatrix::needColumn(int resource_id) const
+{
+	assert (sanityCheck(0, resource_id));
+	return &need_by_resource[resource_id * num_tasks];
+}
+
+int AllocationMatrix::getNumTasks() const
+{
+	return num_tasks;
+}
+
+int AllocationMatrix::getNumResources() const
+{
+	return num_resources;
+}
@@ -7,24 +7,91 @@
 #include <algorithm>
 #include <assert.h>
 #include <iostream>
+#include <limits.h>
 #include "data_types.h"
+#include "event_trace.h"
+#include "policy_manager.h"
+#include "run_stats.h"
+#include "simd_kernels.h"
 
 using namespace std;
 
 BankerResourceManager::BankerResourceManager(int num_resources, int tasks, int* resources_initial):
-	ResourceManager(num_resources, tasks, resources_initial){}
+	PolicyResourceManager(num_resources, tasks, resources_initial)
+{
+	claims_against_total = false;
+	resetBankerState();
+}
+
+void BankerResourceManager::reinitialize(int n_resources, int tasks, int* resources_initial)
+{
+	ResourceManager::reinitialize(n_resources, tasks, resources_initial);
+	resetBankerState();
+}
+
+// Input files initiate every claim before anything is granted, so a claim is checked against the units
+// available. Online, a task can initiate after others hold units, and its claim is checked against all of them
+void BankerResourceManager::setClaimsAgainstTotal(bool enabled)
+{
+	claims_against_total = enabled;
+}
+
+// Size the safety check's state for the current number of tasks and resources, reusing storage
+void BankerResourceManager::resetBankerState()
+{
+	int tasks = getNumTasks(), num_resources = getNumResources();
+	retired.assign(tasks, false);
+	refusal_epoch.assign(tasks, -1);
+	refusal_retires.assign(tasks, 0);
+	refusal_blockers.resize(tasks);
+	for (int i = 0; i < tasks; i++)
+	{
+		refusal_blockers[i].clear();
+	}
+	missing.assign(tasks, 0);
+	missing_check.assign(tasks, 0);
+	work.assign(num_resources, 0);
+	finish_queue.clear();
+	finish_queue.reserve(tasks);
+	live_count = tasks;
+	retire_count = 0;
+	check_count = 0;
+	claims_epoch = 0;
+	known_safe = pending_safe = true;
+
+	// Every need starts at 0, so no task is short of anything
+	need_order.resize(num_resources);
+	order_pos.resize(num_resources);
+	order_pos_check.assign(num_resources, 0);
+	order_available.assign(getResourcesAvailableArray(), getResourcesAvailableArray() + num_resources);
+	short_count.assign(tasks, 0);
+	ready_tasks.resize(tasks);
+	for (int i = 0; i < num_resources; i++)
+	{
+		need_order[i].clear();
+		for (int j = 0; j < tasks; j++)
+		{
+			need_order[i].insert(need_order[i].end(), std::make_pair(0, j));
+		}
+	}
+	for (int j = 0; j < tasks; j++)
+	{
+		ready_tasks.pushBack(j);
+	}
+}
 
 // For each cycle, for each task, dispatch the appropriate action
+template <int N>
 void BankerResourceManager::dispatchAction(Task &task)
 {
-	const Action action = *task.getActionPointer();
+	const Action &action = *task.getActionPointer();
 	switch(action.getType())
 	{
 	case(INITIATE):
 			dispatchInitiate(action, task);
 			break;
 	case(REQUEST):
-			dispatchRequest(action, task);
+			dispatchRequest<N>(action, task);
 			break;
 	case(RELEASE):
 			dispatchRelease(action, task);
@@ -35,38 +102,51 @@ void BankerResourceManager::dispatchAction(Task &task)
 	}
 }
 
-// Set the int at resource_claimed[id] to the value given by action. If claim exceeds resources available, abort the task.
+// Set the int at resource_claimed[id] to the value given by action. If claim exceeds resources available (or
+// present, see setClaimsAgainstTotal), abort the task.
 void BankerResourceManager::dispatchInitiate(const Action &action, Task& task)
 {
 	assert (task.getId() == action.getTaskId());
 
 	int resource_id = action.getResourceId();
 	int claim = action.getAmount();
-	int available = getResourcesAvailable(resource_id);
+	int available = claims_against_total ? getTotalResources(resource_id) : getResourcesAvailable(resource_id);
 
 	if (claim > available)
 	{
 		task.abort();
 		task.setTimeTerminated(getCycle());
-		std::cout << "Banker aborts task # " << task.getId() + 1 << " before run begins: \n";
-		std::cout << "\tclaim for resource " << resource_id + 1 << " (" << claim << ") exceeds number of units present: "
+		retire(task.getId());
+		getOutput() << "Banker aborts task # " << task.getId() + 1 << " before run begins: \n";
+		getOutput() << "\tclaim for resource " << resource_id + 1 << " (" << claim << ") exceeds number of units present: "
 				  << available << ".\n";
+		if (getTracer())
+			getTracer()->record(getCycle(), TRACE_CLAIM_ABORT, task.getId(), resource_id, claim, available);
 		return;
 	}
+	// A bigger claim can make the state unsafe; a smaller one can make refused requests safe
+	int old_claim = task.getResourceClaim(resource_id);
+	if (claim > old_claim)
+		known_safe = pending_safe = false;
+	else if (claim < old_claim)
+		claims_epoch++;
 	task.setTimeCreated(getCycle());
+	unlinkNeed(task.getId(), resource_id);
 	task.setResourceClaimed(resource_id, claim);
-#ifdef DEBUG
-	std::cout << "At cycle " << getCycle() << " - " << getCycle() + 1 <<
-					" Task # " << task.getId() + 1 << " was initialized with claim "
-					<< action.getAmount() << " of resource " << resource_id + 1 << "\n";
-#endif
+	linkNeed(task.getId(), resource_id);
+	if (getTracer())
+		getTracer()->record(getCycle(), TRACE_INITIATE, task.getId(), resource_id, action.getAmount(), 0);
 }
 
 // For a request, first check if the request exceeds the claim of the process
 // If there's a delay, increment the delay counter until delay == action.delay
-// Then, check if state is safe by iterating through all resources and checking claim vs available resources
+// Then, check if state is safe. The cheap check is whether the task could run to completion with what's
+// available (then it can finish first). Otherwise run the full safety check over all live tasks, unless the
+// same request was already found unsafe and nothing that could make it safe has happened since (see
+// refusalStillHolds)
 // Otherwise, if request cannot be granted, block process. If it's already blocked, increase wait time
 // If request can be granted, grant the resources
+template <int N>
 void BankerResourceManager::dispatchRequest(const Action &action, Task& task)
 {
 	assert (task.getId() == action.getTaskId());
@@ -84,33 +164,42 @@ void BankerResourceManager::dispatchRequest(const Action &action, Task& task)
 			resource = task.getResourceHeld(i);
 			if (resource > 0)
 			{
+				unlinkNeed(task.getId(), i);
 				task.releaseResources(i, resource);
 				incrementResourcesAvailable(i, resource);
+				pending_safe = false;
 			}
 		}
 		task.setTimeTerminated(getCycle());
-		std::cout << "Task # " << task.getId() + 1 << " request exceeded claim. Aborted!\n";
+		retire(task.getId());
+		getOutput() << "Task # " << task.getId() + 1 << " request exceeded claim. Aborted!\n";
+		if (getTracer())
+			getTracer()->record(getCycle(), TRACE_REQUEST_ABORT, task.getId(), requested_resource_id, amount_requested, 0);
 		return;
 	}
 
-	if (task.getDelay() < action.getDelay())
+	if (isComputing(action, task))
 	{
-		task.incrementDelay();
-#ifdef DEBUG
-		std::cout << "Task # " << task.getId() + 1 << " is delayed (" << task.getDelay() <<
-				" of " << action.getDelay() << " cycles).\n";
-#endif
+		if (getTracer())
+			getTracer()->record(getCycle(), TRACE_DELAYED, task.getId(), -1, task.getDelay(), action.getDelay());
 	}else
 	{
 		// Check if state is safe
-		bool safe = true;
-		for (int i = 0; i < getNumResources(); i++)
+		int task_id = task.getId();
+		bool safe = canFinishAfterGrant<N>(task_id, requested_resource_id, amount_requested);
+		if (!safe && refusalStillHolds(task_id))
 		{
-
-			if (getResourcesAvailable(i) < task.getResourceClaim(i) - task.getResourceHeld(i))
+			if (getStats())
+				getStats()->cached_refusals++;
+		}
+		else if (!safe)
+		{
+			if (getStats())
+				getStats()->safety_checks++;
+			safe = isSafeAfterGrant<N>(task_id, requested_resource_id, amount_requested);
+			if (!safe)
 			{
-				safe = false;
-				break;
+				recordRefusal(task_id, requested_resource_id, amount_requested);
 			}
 		}
 		if (!safe)
@@ -119,22 +208,26 @@ void BankerResourceManager::dispatchRequest(const Action &action, Task& task)
 			{
 				task.block();
 				task.setBlockedSince(getCycle());
+				if (getStats())
+					getStats()->blocks++;
 			}
-#ifdef DEBUG
-			std::cout << " Task # " << task.getId() + 1<< " could not be granted its resource!\n";
-#endif
+			if (getTracer())
+				getTracer()->record(getCycle(), TRACE_REFUSED, task_id, requested_resource_id, amount_requested, 0);
 		}
 		else
 		{
 			task.unblock();
 			task.setDelay(0);
+			unlinkNeed(task_id, requested_resource_id);
 			task.grantResources(requested_resource_id, amount_requested);
+			linkNeed(task_id, requested_resource_id);
 			decrementResourcesAvailable(requested_resource_id, amount_requested);
-#ifdef DEBUG
-			std::cout << " Task # " << task.getId() + 1 << " was granted " << amount_requested <<
-					" of resource " << requested_resource_id + 1 << ". It now holds " <<
-					task.getResourceHeld(requested_resource_id) << " of that resource.\n";
-#endif
+			refusal_epoch[task_id] = -1;
+			if (getStats())
+				getStats()->grants++;
+			if (getTracer())
+				getTracer()->record(getCycle(), TRACE_GRANTED, task_id, requested_resource_id, amount_requested,
+						task.getResourceHeld(requested_resource_id));
 		}
 	}
 
@@ -149,25 +242,23 @@ void BankerResourceManager::dispatchRelease(const Action &action, Task& task)
 	int released_resource_id = action.getResourceId();
 	int amount_released = action.getAmount();
 
-	if (task.getDelay() < action.getDelay())
+	if (isComputing(action, task))
 	{
-		task.incrementDelay();
-#ifdef DEBUG
-		std::cout << "Task # " << task.getId() + 1 << " is computing (" << task.getDelay() <<
-						" of " << action.getDelay() << " cycles).\n";
-#endif
+		if (getTracer())
+			getTracer()->record(getCycle(), TRACE_COMPUTING, task.getId(), -1, task.getDelay(), action.getDelay());
 	}
 	else
 	{
 		task.unblock();
 		task.setDelay(0);
+		unlinkNeed(task.getId(), released_resource_id);
 		task.releaseResources(released_resource_id, amount_released);
+		linkNeed(task.getId(), released_resource_id);
 		incrementResourcesAvailable(released_resource_id, amount_released);
-#ifdef DEBUG
-		std::cout << " Task # " << task.getId() + 1 << " is releasing " << amount_released <<
-				" of resource " << released_resource_id + 1 << ". It now holds " <<
-				task.getResourceHeld(released_resource_id) << " of that resource.\n";
-#endif
+		pending_safe = false;
+		if (getTracer())
+			getTracer()->record(getCycle(), TRACE_RELEASED, task.getId(), released_resource_id, amount_released,
+					task.getResourceHeld(released_resource_id));
 	}
 
 }
@@ -179,21 +270,333 @@ void BankerResourceManager::dispatchTerminate(const Action &action, Task& task)
 {
 	assert (task.getId() == action.getTaskId());
 	assert (!task.isDoneOrAborted());
-	if (task.getDelay() < action.getDelay())
+	if (isComputing(action, task))
 	{
-		task.incrementDelay();
-#ifdef DEBUG
-		std::cout << "Task # " << task.getId() + 1 << " is computing (" << task.getDelay() <<
-						" of " << action.getDelay() << " cycles).\n";
-#endif
+		if (getTracer())
+			getTracer()->record(getCycle(), TRACE_COMPUTING, task.getId(), -1, task.getDelay(), action.getDelay());
 	}
 	else
 	{
 		task.setDelay(0);
 		task.setTimeTerminated(getCycle());
-#ifdef DEBUG
-		std::cout << " Task # " << task.getId() + 1 << " is terminated. \n";
-#endif
+		retire(task.getId());
+		if (getTracer())
+			getTracer()->record(getCycle(), TRACE_TERMINATED, task.getId(), -1, 0, 0);
+	}
+}
+
+// A live task's need for a resource can only change between unlinkNeed and linkNeed, which take it out of
+// that resource's ordering and put it back in its new place, keeping its short count up to date. Both are
+// O(log tasks). Unlinking a task that's already out of the ordering does nothing
+void BankerResourceManager::unlinkNeed(int task_id, int resource_id)
+{
+	const int* need = getAllocations().needColumn(resource_id);
+	if (need_order[resource_id].erase(std::make_pair(need[task_id], task_id)) > 0
+			&& need[task_id] > order_available[resource_id])
+	{
+		addShort(task_id, -1);
+	}
+}
+
+void BankerResourceManager::linkNeed(int task_id, int resource_id)
+{
+	if (retired[task_id])
+		return;
+
+	const int* need = getAllocations().needColumn(resource_id);
+	need_order[resource_id].insert(std::make_pair(need[task_id], task_id));
+	if (need[task_id] > order_available[resource_id])
+	{
+		addShort(task_id, 1);
+	}
+}
+
+// Take a terminated or aborted task out of the safety check and out of every need ordering
+void BankerResourceManager::retire(int task_id)
+{
+	if (retired[task_id])
+		return;
+
+	// Units the task still holds never come back, which can leave the others unable to finish
+	const int* held = getAllocations().heldRow(task_id);
+	for (int i = 0; i < getNumResources(); i++)
+	{
+		unlinkNeed(task_id, i);
+		if (held[i] > 0)
+			known_safe = pending_safe = false;
+	}
+	retired[task_id] = true;
+	ready_tasks.remove(task_id);
+	live_count--;
+	retire_count++;
+}
+
+void BankerResourceManager::addShort(int task_id, int delta)
+{
+	bool was_ready = short_count[task_id] == 0;
+	short_count[task_id] += delta;
+	if (was_ready && short_count[task_id] > 0)
+	{
+		ready_tasks.remove(task_id);
+	}
+	else if (!was_ready && short_count[task_id] == 0)
+	{
+		ready_tasks.pushBack(task_id);
+	}
+}
+
+// Bring the short counts up to date with what's available now. Grants and commits since the last check moved
+// some resources' available units; only the tasks whose need lies between the old and new amounts change
+void BankerResourceManager::catchUpOrders()
+{
+	const int* available = getResourcesAvailableArray();
+	int num_resources = getNumResources();
+	for (int i = 0; i < num_resources; i++)
+	{
+		int from = order_available[i], to = available[i];
+		if (from == to)
+			continue;
+
+		int low = std::min(from, to), high = std::max(from, to);
+		int delta = to < from ? 1 : -1;
+		for (need_order_t::const_iterator it = need_order[i].upper_bound(std::make_pair(low, INT_MAX));
+				it != need_order[i].end() && it->first <= high; ++it)
+		{
+			addShort(it->second, delta);
+		}
+		order_available[i] = to;
+	}
+}
+
+// A task's count of resources it is still short of in the current check. Tasks the check hasn't touched
+// start from their short count, so setting up a check doesn't cost a pass over every task
+inline int& BankerResourceManager::missingFor(int task_id)
+{
+	if (missing_check[task_id] != check_count)
+	{
+		missing_check[task_id] = check_count;
+		missing[task_id] = short_count[task_id];
+	}
+	return missing[task_id];
+}
+
+// A refused request stays unsafe until enough units of a resource that blocked the check come back, every
+// task that couldn't finish in it retires, or a claim is lowered. Grants, bigger claims and other releases
+// can't make an unsafe state safe: the tasks that couldn't finish would still be short of the same resources
+// by at least as much
+bool BankerResourceManager::refusalStillHolds(int task_id)
+{
+	if (refusal_epoch[task_id] != claims_epoch || retire_count >= refusal_retires[task_id])
+		return false;
+
+	const std::vector<std::pair<int, long long> > &blockers = refusal_blockers[task_id];
+	for (unsigned int i = 0; i < blockers.size(); i++)
+	{
+		if (getUnitsReturned(blockers[i].first) >= blockers[i].second)
+			return false;
+	}
+	return true;
+}
+
+// After a failed check, record for each resource some unfinished task was short of the fewest units that
+// would have to come back before one of them could finish: the first task past the work vector in that
+// resource's ordering, or the requester, which is checked on its own. If the requester couldn't finish, it can't retire while
+// it waits, so retirements alone never help
+void BankerResourceManager::recordRefusal(int task_id, int resource_id, int amount)
+{
+	std::vector<std::pair<int, long long> > &blockers = refusal_blockers[task_id];
+	refusal_epoch[task_id] = claims_epoch;
+	blockers.clear();
+	if (getResourcesAvailable(resource_id) < amount)
+	{
+		refusal_retires[task_id] = INT_MAX;
+		blockers.push_back(std::make_pair(resource_id,
+				getUnitsReturned(resource_id) + amount - getResourcesAvailable(resource_id)));
+		return;
+	}
+
+	const int* task_need = getAllocations().needRow(task_id);
+	bool requester_blocked = false;
+	for (int i = 0; i < getNumResources(); i++)
+	{
+		const need_order_t &order = need_order[i];
+		int shortfall = INT_MAX;
+		if (!order.empty() && order.rbegin()->first > work[i])
+		{
+			need_order_t::const_iterator it = order.upper_bound(std::make_pair(work[i], INT_MAX));
+			if (it->second == task_id)
+				++it;
+			if (it != order.end())
+				shortfall = it->first - work[i];
+		}
+		int requester_need = task_need[i] - (i == resource_id ? amount : 0);
+		if (requester_need > work[i])
+		{
+			requester_blocked = true;
+			shortfall = std::min(shortfall, requester_need - work[i]);
+		}
+		if (shortfall != INT_MAX)
+		{
+			blockers.push_back(std::make_pair(i, getUnitsReturned(i) + shortfall));
+		}
+	}
+	refusal_retires[task_id] = requester_blocked ? INT_MAX
+			: retire_count + live_count - 1 - (int)finish_queue.size();
+}
+
+// True if, after the grant, the task's remaining claim fits in what's available for every resource.
+// The task could then run to completion first, so (given a safe state before) the state stays safe
+template <int N>
+bool BankerResourceManager::canFinishAfterGrant(int task_id, int resource_id, int amount)
+{
+	const int* task_need = getAllocations().needRow(task_id);
+	return fixedAllLessEqual<N>(task_need, getResourcesAvailableArray(), getNumResources())
+			&& getResourcesAvailable(resource_id) >= amount;
+}
+
+// Add units to one resource in the work vector, and walk its need ordering on from the tasks that were short
+// of it, as far as the work now allows. A task goes on the finish queue once it isn't short of any resource.
+// The walk starts where the last one stopped; the first time in a check, past the tasks that weren't short
+void BankerResourceManager::returnToWork(int resource_id, int units, int skip_task)
+{
+	const need_order_t &order = need_order[resource_id];
+	need_order_t::const_iterator &pos = order_pos[resource_id];
+	if (order_pos_check[resource_id] != check_count)
+	{
+		order_pos_check[resource_id] = check_count;
+		pos = order.upper_bound(std::make_pair(work[resource_id], INT_MAX));
+	}
+	work[resource_id] += units;
+	while (pos != order.end() && pos->first <= work[resource_id])
+	{
+		int id = pos->second;
+		++pos;
+		if (id == skip_task)
+			continue;
+		if (--missingFor(id) == 0)
+		{
+			finish_queue.push_back(id);
+		}
+	}
+}
+
+// Whether the requesting task's need, less the amount about to be granted, fits in the work vector
+template <int N>
+bool BankerResourceManager::requesterFits(const int* task_need, int resource_id, int amount)
+{
+	if (N == 0)
+	{
+		int num_resources = getNumResources();
+		return task_need[resource_id] - amount <= work[resource_id]
+				&& simdAllLessEqual(task_need, work.data(), resource_id)
+				&& simdAllLessEqual(task_need + resource_id + 1, work.data() + resource_id + 1,
+						num_resources - resource_id - 1);
+	}
+	bool fits = true;
+	for (int i = 0; i < N; i++)
+	{
+		fits &= task_need[i] - (i == resource_id ? amount : 0) <= work[i];
+	}
+	return fits;
+}
+
+// Banker's safety check over all live tasks, for the state after granting amount of resource_id to task_id.
+// Tasks that can finish with the current work vector return what they hold, which may let more tasks finish.
+// The check starts from the tasks that aren't short of anything, and each ordering is only walked over the
+// tasks whose shortage the growing work vector covers, so a check that gets stuck early is cheap. One that
+// finishes every task is O(tasks * resources).
+// The requesting task's need is about to change, so it is checked directly instead of through the orderings.
+// If the state before the grant is known to be safe, the check can stop as soon as the requester finishes:
+// from then on the work vector is at least what it would have been without the grant. A release leaves the
+// units it gives back out of the check until they're committed, so until then it takes a full check to know
+template <int N>
+bool BankerResourceManager::isSafeAfterGrant(int task_id, int resource_id, int amount)
+{
+	int num_resources = resourceCount<N>();
+	if (getResourcesAvailable(resource_id) < amount)
+		return false;
+
+	catchUpOrders();
+	check_count++;
+	const int* available = getResourcesAvailableArray();
+	std::copy(available, available + num_resources, work.begin());
+	work[resource_id] -= amount;
+
+	// The grant leaves the tasks whose need lies in the units it takes short of the resource as well
+	const need_order_t &granted_order = need_order[resource_id];
+	for (need_order_t::const_iterator it = granted_order.upper_bound(std::make_pair(work[resource_id], INT_MAX));
+			it != granted_order.end() && it->first <= available[resource_id]; ++it)
+	{
+		if (it->second != task_id)
+			missingFor(it->second)++;
+	}
+	finish_queue.clear();
+	for (int id = ready_tasks.front(); id >= 0; id = ready_tasks.nextOf(id))
+	{
+		if (id != task_id && missingFor(id) == 0)
+			finish_queue.push_back(id);
+	}
+
+	const AllocationMatrix &allocations = getAllocations();
+	const int* task_need = allocations.needRow(task_id);
+	const int* task_held = allocations.heldRow(task_id);
+	bool requester_finished = false;
+	bool safe_before = hasPendingReleases() ? pending_safe : known_safe;
+	int finished = 0;
+	unsigned int next = 0;
+	while (true)
+	{
+		int id = -1;
+		if (!requester_finished)
+		{
+			bool fits = requesterFits<N>(task_need, resource_id, amount);
+			if (fits)
+			{
+				requester_finished = true;
+				id = task_id;
+			}
+		}
+		if (id < 0)
+		{
+			if (next == finish_queue.size())
+				break;
+			id = finish_queue[next++];
+		}
+
+		finished++;
+		if (finished == live_count || (safe_before && id == task_id))
+		{
+			known_safe = pending_safe = true;
+			return true;
+		}
+
+		const int* returned = (id == task_id) ? task_held : allocations.heldRow(id);
+		for (int i = 0; i < num_resources; i++)
+		{
+			int amount_returned = returned[i] + ((id == task_id && i == resource_id) ? amount : 0);
+			if (amount_returned > 0)
+			{
+				returnToWork(i, amount_returned, task_id);
+			}
+		}
 	}
+	return false;
 }
 
+// The runtime-sized loop, and one with the count fixed for each of 1 to MAX_FIXED_RESOURCES resource types
+template class PolicyResourceManager<BankerResourceManager>;
+template void PolicyResourceManager<BankerResourceManager>::dispatchCycle<0>(taskvec_t &task_list);
+template void PolicyResourceManager<BankerResourceManager>::dispatchCycle<1>(taskvec_t &task_list);
+template void PolicyResourceManager<BankerResourceManager>::dispatchCycle<2>(taskvec_t &task_list);
+template void PolicyResourceManager<BankerResourceManager>::dispatchCycle<3>(taskvec_t &task_list);
+template void PolicyResourceManager<BankerResourceManager>::dispatchCycle<4>(taskvec_t &task_list);
+template void PolicyResourceManager<BankerResourceManager>::dispatchRunnable<0>(Task &task);
+template void PolicyResourceManager<BankerResourceManager>::dispatchRunnable<1>(Task &task);
+template void PolicyResourceManager<BankerResourceManager>::dispatchRunnable<2>(Task &task);
+template void PolicyResourceManager<BankerResourceManager>::dispatchRunnable<3>(Task &task);
+template void PolicyResourceManager<BankerResourceManager>::dispatchRunnable<4>(Task &task);
+template void PolicyResourceManager<BankerResourceManager>::retryBlocked<0>(taskvec_t &task_list, vector<int> &woken);
+template void PolicyResourceManager<BankerResourceManager>::retryBlocked<1>(taskvec_t &task_list, vector<int> &woken);
+template void PolicyResourceManager<BankerResourceManager>::retryBlocked<2>(taskvec_t &task_list, vector<int> &woken);
+template void PolicyResourceManager<BankerResourceManager>::retryBlocked<3>(taskvec_t &task_list, vector<int> &woken);
+template void PolicyResourceManager<BankerResourceManager>::retryBlocked<4>(taskvec_t &task_list, vector<int> &woken);
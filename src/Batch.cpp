@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <dirent.h>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <sys/stat.h>
+#include "batch.h"
+#include "binary_trace.h"
+#include "simulation.h"
+#include "thread_pool.h"
+#include "trace_parser.h"
+
+using namespace std;
+
+// What one input produced. Kept until every input before it has been written
+struct BatchResult
+{
+	bool done, failed;
+	string output;
+	SimulationSummary optimistic, banker;
+};
+
+// Each worker keeps its simulation, parse buffers and action table from one input to the next
+struct BatchWorker
+{
+	Simulation simulation;
+	TraceInput input;
+	ActionTable action_table;
+};
+
+static bool isDirectory(const string &path)
+{
+	struct stat info;
+	return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+static bool isRegularFile(const string &path)
+{
+	struct stat info;
+	return stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode);
+}
+
+bool listBatchInputs(const string &path, vector<string> &inputs, string &error)
+{
+	inputs.clear();
+	if (isDirectory(path))
+	{
+		DIR* dir = opendir(path.c_str());
+		if (!dir)
+		{
+			error = "unable to read directory " + path;
+			return false;
+		}
+		for (struct dirent* entry = readdir(dir); entry; entry = readdir(dir))
+		{
+			string name = entry->d_name;
+			string file = path + "/" + name;
+			if (name.compare(0, 5, "input") == 0 && isRegularFile(file))
+			{
+				inputs.push_back(file);
+			}
+		}
+		closedir(dir);
+		sort(inputs.begin(), inputs.end());
+		return true;
+	}
+
+	ifstream manifest(path.c_str());
+	if (!manifest)
+	{
+		error = "unable to open manifest " + path;
+		return false;
+	}
+	string base;
+	size_t slash = path.rfind('/');
+	if (slash != string::npos)
+	{
+		base = path.substr(0, slash + 1);
+	}
+
+	string line;
+	while (getline(manifest, line))
+	{
+		size_t first = line.find_first_not_of(" \t\r");
+		if (first == string::npos || line[first] == '#')
+			continue;
+		size_t last = line.find_last_not_of(" \t\r");
+		string file = line.substr(first, last - first + 1);
+		inputs.push_back(file[0] == '/' ? file : base + file);
+	}
+	return true;
+}
+
+// Load one input into the worker's buffers and run both managers on it, one after the other
+static void simulateInput(BatchWorker &worker, const string &filename, bool event_driven, BatchResult &result)
+{
+	ostringstream out;
+	out << "==> " << filename << " <==\n";
+
+	ParseError error;
+	BinaryTrace binary_trace;
+	TraceInput &input = worker.input;
+	const ActionTable* action_table = &worker.action_table;
+	ActionTable mapped_table;
+	bool loaded;
+	if (isBinaryTraceFile(filename))
+	{
+		loaded = binary_trace.open(filename, error);
+		if (loaded)
+		{
+			input.num_tasks = binary_trace.getNumTasks();
+			input.num_resources = binary_trace.getNumResources();
+			input.resources.assign(binary_trace.getResources(), binary_trace.getResources() + input.num_resources);
+			mapped_table = binary_trace.getActionTable();
+			action_table = &mapped_table;
+		}
+	}
+	else
+	{
+		loaded = parseTraceFile(filename, input, error);
+		if (loaded)
+		{
+			worker.action_table.rebuild(input.num_tasks, input.actions);
+		}
+	}
+
+	if (!loaded)
+	{
+		if (error.line > 0)
+			out << filename << ":" << error.line << ":" << error.column << ": " << error.message << "\n\n";
+		else
+			out << "Unable to open " << filename << " for input (" << error.message << ")\n\n";
+		result.failed = true;
+		result.output = out.str();
+		return;
+	}
+
+	Simulation &simulation = worker.simulation;
+	simulation.setEventDriven(event_driven);
+	simulation.prepare(input.num_tasks, input.num_resources, input.resources.data());
+	simulation.bindStreams(*action_table);
+	result.optimistic = simulation.runOptimistic(out);
+	result.banker = simulation.runBanker(out);
+	result.failed = false;
+	result.output = out.str();
+}
+
+static void printSummaryLine(const char* name, long long cycles, long long blocked, long long aborted, ostream &out)
+{
+	out << "\t" << name << "\ttotal cycles " << cycles << "\tblocked " << blocked << "\taborted " << aborted << "\n";
+}
+
+int runBatch(const vector<string> &inputs, int jobs, bool event_driven, ostream &out)
+{
+	int num_inputs = inputs.size();
+	vector<BatchResult> results(num_inputs);
+	for (int i = 0; i < num_inputs; i++)
+	{
+		results[i].done = false;
+		results[i].failed = false;
+	}
+
+	WorkStealingPool pool(min(jobs, max(num_inputs, 1)));
+	vector<unique_ptr<BatchWorker> > workers;
+	for (int i = 0; i < pool.getNumWorkers(); i++)
+	{
+		workers.push_back(unique_ptr<BatchWorker>(new BatchWorker()));
+	}
+
+	// Whoever finishes the input that's next in order writes it, and every finished input after it
+	mutex output_lock;
+	int next_to_write = 0;
+	pool.run(num_inputs, [&](int worker, int job)
+	{
+		BatchResult result;
+		simulateInput(*workers[worker], inputs[job], event_driven, result);
+
+		lock_guard<mutex> guard(output_lock);
+		results[job] = result;
+		results[job].done = true;
+		while (next_to_write < num_inputs && results[next_to_write].done)
+		{
+			out << results[next_to_write].output;
+			string().swap(results[next_to_write].output);
+			next_to_write++;
+		}
+	});
+
+	int failed = 0;
+	long long totals[2][3] = { { 0, 0, 0 }, { 0, 0, 0 } };
+	for (int i = 0; i < num_inputs; i++)
+	{
+		if (results[i].failed)
+		{
+			failed++;
+			continue;
+		}
+		const SimulationSummary* runs[2] = { &results[i].optimistic, &results[i].banker };
+		for (int j = 0; j < 2; j++)
+		{
+			totals[j][0] += runs[j]->total_cycles;
+			totals[j][1] += runs[j]->total_blocked;
+			totals[j][2] += runs[j]->aborted_tasks;
+		}
+	}
+
+	out << "Batch summary: " << num_inputs << " inputs, " << failed << " failed\n";
+	printSummaryLine("FIFO", totals[0][0], totals[0][1], totals[0][2], out);
+	printSummaryLine("Banker", totals[1][0], totals[1][1], totals[1][2], out);
+	out.flush();
+	return failed;
+}
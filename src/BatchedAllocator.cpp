@@ -0,0 +1,244 @@
+#include "batched_allocator.h"
+
+using namespace std;
+
+// Times a waiting thread yields before it goes to sleep
+#define SPINS_BEFORE_SLEEP 64
+
+// The core thread is started last, once everything it reads is set up
+BatchedAllocator::BatchedAllocator(int num_tasks, const vector<int> &units, int batch_limit) :
+	ring(BATCH_RING_SIZE), enqueue_position(0), dequeue_position(0), allocator(false, num_tasks, units),
+	max_batch(max(1, batch_limit)), stopping(false), core_sleeping(false), messages(0), batches(0), ticks(0)
+{
+	for (unsigned long i = 0; i < ring.size(); i++)
+	{
+		ring[i].sequence = i;
+	}
+	for (int i = 0; i < num_tasks; i++)
+	{
+		unique_ptr<DecisionSlot> slot(new DecisionSlot());
+		slot->published = 0;
+		slot->submitted = 0;
+		slot->decision = DECISION_INVALID;
+		slot->waiting = false;
+		slots.push_back(move(slot));
+	}
+	core = thread(&BatchedAllocator::runCore, this);
+}
+
+BatchedAllocator::~BatchedAllocator()
+{
+	stopping = true;
+	{
+		lock_guard<mutex> guard(core_lock);
+		core_wakeup.notify_one();
+	}
+	core.join();
+}
+
+// Claim the next position with a CAS, fill its cell, then hand it to the core by moving its sequence on.
+// The core is only woken if it has gone to sleep
+void BatchedAllocator::push(const BatchMessage &message)
+{
+	unsigned long position = enqueue_position.load(memory_order_relaxed);
+	RingCell* cell;
+	while (true)
+	{
+		cell = &ring[position & (BATCH_RING_SIZE - 1)];
+		long difference = (long)(cell->sequence.load(memory_order_acquire) - position);
+		if (difference == 0)
+		{
+			if (enqueue_position.compare_exchange_weak(position, position + 1, memory_order_relaxed))
+				break;
+		}
+		else if (difference < 0)
+		{
+			// Full: the core hasn't taken the message a lap ago yet
+			this_thread::yield();
+			position = enqueue_position.load(memory_order_relaxed);
+		}
+		else
+		{
+			position = enqueue_position.load(memory_order_relaxed);
+		}
+	}
+	cell->message = message;
+	cell->sequence.store(position + 1);
+
+	if (core_sleeping.load())
+	{
+		lock_guard<mutex> guard(core_lock);
+		core_wakeup.notify_one();
+	}
+}
+
+bool BatchedAllocator::pop(BatchMessage &message)
+{
+	RingCell &cell = ring[dequeue_position & (BATCH_RING_SIZE - 1)];
+	if (cell.sequence.load(memory_order_acquire) != dequeue_position + 1)
+		return false;
+	message = cell.message;
+	cell.sequence.store(dequeue_position + BATCH_RING_SIZE, memory_order_release);
+	dequeue_position++;
+	return true;
+}
+
+bool BatchedAllocator::ringEmpty()
+{
+	return ring[dequeue_position & (BATCH_RING_SIZE - 1)].sequence.load() != dequeue_position + 1;
+}
+
+// core_sleeping is set before the ring is looked at again, and a producer fills its cell before it looks at
+// core_sleeping, so either the message is seen here or the producer wakes the core
+void BatchedAllocator::sleepUntilPushed()
+{
+	for (int i = 0; i < SPINS_BEFORE_SLEEP; i++)
+	{
+		if (!ringEmpty() || stopping.load())
+			return;
+		this_thread::yield();
+	}
+	unique_lock<mutex> guard(core_lock);
+	core_sleeping = true;
+	while (ringEmpty() && !stopping.load())
+	{
+		core_wakeup.wait(guard);
+	}
+	core_sleeping = false;
+}
+
+// Apply up to max_batch actions, then tick once. While tasks are still blocked, one more tick follows a batch
+// even when nothing else arrives, since its actions may have left every live task blocked and the tick after
+// finds that deadlock
+void BatchedAllocator::runCore()
+{
+	bool changed = false;
+	while (true)
+	{
+		int batch = 0;
+		BatchMessage message;
+		while (batch < max_batch && pop(message))
+		{
+			apply(message);
+			batch++;
+		}
+		if (batch > 0 || changed)
+		{
+			granted.clear();
+			aborted.clear();
+			allocator.tick(granted, aborted);
+			for (unsigned int i = 0; i < granted.size(); i++)
+			{
+				publish(granted[i], DECISION_GRANTED);
+			}
+			for (unsigned int i = 0; i < aborted.size(); i++)
+			{
+				publish(aborted[i], DECISION_ABORTED);
+			}
+			messages.store(messages.load(memory_order_relaxed) + batch, memory_order_relaxed);
+			batches.store(batches.load(memory_order_relaxed) + (batch > 0), memory_order_relaxed);
+			ticks.store(ticks.load(memory_order_relaxed) + 1, memory_order_relaxed);
+			changed = (batch > 0 || !granted.empty() || !aborted.empty()) && allocator.getNumBlocked() > 0;
+			continue;
+		}
+		if (stopping.load())
+			break;
+		sleepUntilPushed();
+	}
+}
+
+// A blocked request is answered later, by the tick that grants or aborts it
+void BatchedAllocator::apply(const BatchMessage &message)
+{
+	decision_t decision;
+	switch (message.type)
+	{
+	case INITIATE:
+		decision = allocator.initiate(message.task_id, message.resource_id, message.amount);
+		break;
+	case REQUEST:
+		decision = allocator.request(message.task_id, message.resource_id, message.amount);
+		break;
+	case RELEASE:
+		decision = allocator.release(message.task_id, message.resource_id, message.amount);
+		break;
+	default:
+		decision = allocator.terminate(message.task_id);
+		break;
+	}
+	if (decision != DECISION_BLOCKED)
+		publish(message.task_id, decision);
+}
+
+void BatchedAllocator::publish(int task_id, decision_t decision)
+{
+	DecisionSlot &slot = *slots[task_id];
+	slot.decision = decision;
+	slot.published++;
+	if (slot.waiting.load())
+	{
+		lock_guard<mutex> guard(slot.lock);
+		slot.ready.notify_one();
+	}
+}
+
+// Push the action and wait for its decision: a few yields first, since a batch is usually quick, then asleep
+decision_t BatchedAllocator::submit(action_t type, int task_id, int resource_id, int amount)
+{
+	if (task_id < 0 || task_id >= (int)slots.size())
+		return DECISION_INVALID;
+	DecisionSlot &slot = *slots[task_id];
+	BatchMessage message = { type, task_id, resource_id, amount };
+	unsigned int expected = ++slot.submitted;
+	push(message);
+
+	for (int i = 0; i < SPINS_BEFORE_SLEEP; i++)
+	{
+		if (slot.published.load(memory_order_acquire) == expected)
+			return slot.decision;
+		this_thread::yield();
+	}
+	unique_lock<mutex> guard(slot.lock);
+	slot.waiting = true;
+	while (slot.published.load() != expected)
+	{
+		slot.ready.wait(guard);
+	}
+	slot.waiting = false;
+	return slot.decision;
+}
+
+decision_t BatchedAllocator::initiate(int task_id, int resource_id, int claim)
+{
+	return submit(INITIATE, task_id, resource_id, claim);
+}
+
+decision_t BatchedAllocator::request(int task_id, int resource_id, int amount)
+{
+	return submit(REQUEST, task_id, resource_id, amount);
+}
+
+decision_t BatchedAllocator::release(int task_id, int resource_id, int amount)
+{
+	return submit(RELEASE, task_id, resource_id, amount);
+}
+
+decision_t BatchedAllocator::terminate(int task_id)
+{
+	return submit(TERMINATE, task_id, -1, 0);
+}
+
+long long BatchedAllocator::getMessages() const
+{
+	return messages.load();
+}
+
+long long BatchedAllocator::getBatches() const
+{
+	return batches.load();
+}
+
+long long BatchedAllocator::getTicks() const
+{
+	return ticks.load();
+}
@@ -0,0 +1,518 @@
+#include <algorithm>
+#include <assert.h>
+#include <fcntl.h>
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+#include "binary_trace.h"
+
+// Records are used in place as Actions, so Action must stay five packed 4-byte fields
+static_assert(sizeof(action_t) == sizeof(int32_t), "action_t must be 4 bytes wide");
+static_assert(sizeof(Action) == 5 * sizeof(int32_t), "Action must match the binary trace record layout");
+static_assert(std::is_standard_layout<Action>::value, "Action must be standard layout");
+static_assert(sizeof(BinaryTraceHeader) == 32, "BinaryTraceHeader must not be padded");
+
+static void setError(ParseError &error, const std::string &message)
+{
+	error.line = 0;
+	error.column = 0;
+	error.message = message;
+}
+
+// Checks shared by the mapped loader and the streaming reader: everything but the offsets
+static bool validateHeader(const BinaryTraceHeader &header, uint64_t file_size, ParseError &error)
+{
+	if (memcmp(header.magic, BINARY_TRACE_MAGIC, sizeof(header.magic)) != 0)
+	{
+		setError(error, "not a binary trace");
+		return false;
+	}
+	if (header.byte_order != BINARY_TRACE_BYTE_ORDER)
+	{
+		setError(error, "binary trace was written on a machine with a different byte order");
+		return false;
+	}
+	if (header.version != BINARY_TRACE_VERSION)
+	{
+		setError(error, "unsupported binary trace version " + std::to_string(header.version));
+		return false;
+	}
+	if (header.record_size != sizeof(Action))
+	{
+		setError(error, "binary trace record size doesn't match this build");
+		return false;
+	}
+	if (header.num_tasks < 0 || header.num_resources < 0 || header.num_actions < 0)
+	{
+		setError(error, "binary trace header has a negative count");
+		return false;
+	}
+
+	uint64_t expected_size = sizeof(BinaryTraceHeader)
+			+ sizeof(int32_t) * ((uint64_t)header.num_resources + header.num_tasks + 1)
+			+ sizeof(Action) * (uint64_t)header.num_actions;
+	if (expected_size != file_size)
+	{
+		setError(error, "binary trace size doesn't match its header");
+		return false;
+	}
+	return true;
+}
+
+static bool validateOffsets(const int32_t* offsets, const BinaryTraceHeader &header, ParseError &error)
+{
+	if (offsets[0] != 0 || offsets[header.num_tasks] != header.num_actions)
+	{
+		setError(error, "binary trace offsets don't cover the records");
+		return false;
+	}
+	for (int i = 0; i < header.num_tasks; i++)
+	{
+		if (offsets[i + 1] < offsets[i])
+		{
+			setError(error, "binary trace offsets are not in order");
+			return false;
+		}
+	}
+	return true;
+}
+
+// The checks the text parser makes on each action: a known type, the owning task's id, and a resource in
+// range. The writer stores terminate's unused resource as -1, so nothing else is accepted there
+static bool validateRecord(const Action &action, int task_id, int num_resources, int record, ParseError &error)
+{
+	int type = action.getType();
+	if (type < INITIATE || type > TERMINATE)
+	{
+		setError(error, "unknown action type " + std::to_string(type) + " (record " + std::to_string(record) + ")");
+		return false;
+	}
+	if (action.getTaskId() != task_id)
+	{
+		setError(error, "record " + std::to_string(record) + " belongs to task " + std::to_string(action.getTaskId() + 1)
+				+ " but is stored with task " + std::to_string(task_id + 1));
+		return false;
+	}
+	int resource_id = action.getResourceId();
+	if (type == TERMINATE ? resource_id != -1 : (resource_id < 0 || resource_id >= num_resources))
+	{
+		setError(error, "resource type out of range (record " + std::to_string(record) + ")");
+		return false;
+	}
+	return true;
+}
+
+// Every task has to end with terminate, as in the text format. record is the task's last record, at index
+// offsets[task_id + 1] - 1
+static bool validateLastRecord(const Action &last, int task_id, int record, ParseError &error)
+{
+	if (last.getType() == TERMINATE && last.getTaskId() == task_id)
+		return true;
+	setError(error, "task " + std::to_string(task_id + 1) + " doesn't end with terminate (record "
+			+ std::to_string(record) + ")");
+	return false;
+}
+
+static bool validateTaskHasRecords(const int32_t* offsets, int task_id, ParseError &error)
+{
+	if (offsets[task_id + 1] > offsets[task_id])
+		return true;
+	setError(error, "task " + std::to_string(task_id + 1) + " has no actions");
+	return false;
+}
+
+BinaryTrace::BinaryTrace()
+{
+	mapping = nullptr;
+	mapping_size = 0;
+	header = nullptr;
+	resources = nullptr;
+	offsets = nullptr;
+	records = nullptr;
+}
+
+BinaryTrace::~BinaryTrace()
+{
+	close();
+}
+
+void BinaryTrace::close()
+{
+	if (mapping)
+	{
+		munmap(mapping, mapping_size);
+	}
+	mapping = nullptr;
+	mapping_size = 0;
+	header = nullptr;
+	resources = nullptr;
+	offsets = nullptr;
+	records = nullptr;
+}
+
+// Map the file read-only and check its header, offsets and every record, so a run never meets a record the
+// text parser would have refused
+bool BinaryTrace::open(const std::string &filename, ParseError &error)
+{
+	close();
+
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		setError(error, "unable to open file");
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0)
+	{
+		::close(fd);
+		setError(error, "unable to read file");
+		return false;
+	}
+
+	if ((size_t)info.st_size < sizeof(BinaryTraceHeader))
+	{
+		::close(fd);
+		setError(error, "binary trace is truncated");
+		return false;
+	}
+
+	mapping_size = info.st_size;
+	mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (mapping == MAP_FAILED)
+	{
+		mapping = nullptr;
+		mapping_size = 0;
+		setError(error, "unable to map file");
+		return false;
+	}
+
+	if (!validate(error))
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+bool BinaryTrace::validate(ParseError &error)
+{
+	header = (const BinaryTraceHeader*)mapping;
+	if (!validateHeader(*header, mapping_size, error))
+		return false;
+
+	resources = (const int32_t*)(header + 1);
+	offsets = resources + header->num_resources;
+	records = (const Action*)(offsets + header->num_tasks + 1);
+	if (!validateOffsets(offsets, *header, error))
+		return false;
+	for (int i = 0; i < header->num_tasks; i++)
+	{
+		if (!validateTaskHasRecords(offsets, i, error))
+			return false;
+		for (int j = offsets[i]; j < offsets[i + 1]; j++)
+		{
+			if (!validateRecord(records[j], i, header->num_resources, j, error))
+				return false;
+		}
+		if (!validateLastRecord(records[offsets[i + 1] - 1], i, offsets[i + 1] - 1, error))
+			return false;
+	}
+	return true;
+}
+
+int BinaryTrace::getNumTasks() const
+{
+	return header ? header->num_tasks : 0;
+}
+
+int BinaryTrace::getNumResources() const
+{
+	return header ? header->num_resources : 0;
+}
+
+int BinaryTrace::getNumActions() const
+{
+	return header ? header->num_actions : 0;
+}
+
+const int* BinaryTrace::getResources() const
+{
+	return resources;
+}
+
+ActionTable BinaryTrace::getActionTable() const
+{
+	return ActionTable(getNumTasks(), getNumActions(), records, offsets);
+}
+
+BinaryTraceReader::BinaryTraceReader()
+{
+	fd = -1;
+	window_size = 0;
+	failed = false;
+	memset(&header, 0, sizeof(header));
+	records_start = 0;
+}
+
+BinaryTraceReader::~BinaryTraceReader()
+{
+	close();
+}
+
+void BinaryTraceReader::close()
+{
+	if (fd >= 0)
+	{
+		::close(fd);
+	}
+	fd = -1;
+	resources.clear();
+	offsets.clear();
+	next_record.clear();
+	windows.clear();
+}
+
+bool BinaryTraceReader::readAt(void* buffer, size_t size, off_t position)
+{
+	char* out = (char*)buffer;
+	while (size > 0)
+	{
+		ssize_t n = pread(fd, out, size, position);
+		if (n <= 0)
+			return false;
+		out += n;
+		size -= n;
+		position += n;
+	}
+	return true;
+}
+
+// Read and check the header, resource totals and offsets, and each task's last record. No other action
+// records are read (or checked) until a stream asks
+bool BinaryTraceReader::open(const std::string &filename, int window, ParseError &error)
+{
+	close();
+	failed = false;
+	window_size = window > 0 ? window : 1;
+
+	fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		setError(error, "unable to open file");
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || !readAt(&header, sizeof(header), 0))
+	{
+		close();
+		setError(error, "binary trace is truncated");
+		return false;
+	}
+	if (!validateHeader(header, info.st_size, error))
+	{
+		close();
+		return false;
+	}
+
+	resources.assign(header.num_resources, 0);
+	offsets.assign(header.num_tasks + 1, 0);
+	off_t position = sizeof(header);
+	if (!readAt(resources.data(), sizeof(int32_t) * resources.size(), position)
+			|| !readAt(offsets.data(), sizeof(int32_t) * offsets.size(), position + sizeof(int32_t) * resources.size()))
+	{
+		close();
+		setError(error, "unable to read file");
+		return false;
+	}
+	if (!validateOffsets(offsets.data(), header, error))
+	{
+		close();
+		return false;
+	}
+
+	records_start = position + sizeof(int32_t) * (resources.size() + offsets.size());
+	Action last(TERMINATE, 0, 0, 0, 0);
+	for (int i = 0; i < header.num_tasks; i++)
+	{
+		if (!validateTaskHasRecords(offsets.data(), i, error))
+		{
+			close();
+			return false;
+		}
+		if (!readAt(&last, sizeof(Action), records_start + (off_t)sizeof(Action) * (offsets[i + 1] - 1)))
+		{
+			close();
+			setError(error, "unable to read file");
+			return false;
+		}
+		if (!validateRecord(last, i, header.num_resources, offsets[i + 1] - 1, error)
+				|| !validateLastRecord(last, i, offsets[i + 1] - 1, error))
+		{
+			close();
+			return false;
+		}
+	}
+	next_record.assign(offsets.begin(), offsets.end() - 1);
+	windows.assign(header.num_tasks, actionvec_t());
+	return true;
+}
+
+int BinaryTraceReader::getNumTasks() const
+{
+	return header.num_tasks;
+}
+
+int BinaryTraceReader::getNumResources() const
+{
+	return header.num_resources;
+}
+
+const int* BinaryTraceReader::getResources() const
+{
+	return resources.data();
+}
+
+// Rewind the task to its first action. Each run over the trace takes new streams
+ActionStream BinaryTraceReader::getStream(int task_id)
+{
+	assert (task_id >= 0 && task_id < getNumTasks());
+	next_record[task_id] = offsets[task_id];
+	return ActionStream(this, task_id);
+}
+
+// Read the task's next window into its buffer, reusing the buffer's storage, and check its records. When the
+// task has no actions left (or the read or a record fails) the window is freed and the stream is left empty
+void BinaryTraceReader::refill(int task_id, ActionStream &stream)
+{
+	int first = next_record[task_id];
+	int count = std::min(window_size, offsets[task_id + 1] - first);
+	if (count <= 0)
+	{
+		release(task_id);
+		stream.setWindow(nullptr, nullptr);
+		return;
+	}
+
+	actionvec_t &window = windows[task_id];
+	window.assign(count, Action(TERMINATE, 0, 0, 0, 0));
+	off_t position = records_start + (off_t)sizeof(Action) * first;
+	if (!readAt(window.data(), sizeof(Action) * count, position))
+	{
+		fail(task_id, stream, "Unable to read actions for task " + std::to_string(task_id + 1)
+				+ " from the binary trace");
+		return;
+	}
+	// open only checked each task's last record, so the rest are checked as they are read
+	ParseError error;
+	for (int i = 0; i < count; i++)
+	{
+		if (!validateRecord(window[i], task_id, header.num_resources, first + i, error))
+		{
+			fail(task_id, stream, "Invalid action for task " + std::to_string(task_id + 1)
+					+ " in the binary trace: " + error.message);
+			return;
+		}
+	}
+	next_record[task_id] = first + count;
+
+	int ahead = std::min(window_size, offsets[task_id + 1] - next_record[task_id]);
+	if (ahead > 0)
+	{
+		posix_fadvise(fd, position + sizeof(Action) * count, sizeof(Action) * ahead, POSIX_FADV_WILLNEED);
+	}
+	stream.setWindow(window.data(), window.data() + count);
+}
+
+// Report the first failure only, and end the task's actions there
+void BinaryTraceReader::fail(int task_id, ActionStream &stream, const std::string &message)
+{
+	if (!failed)
+	{
+		std::cerr << message << "\n";
+	}
+	failed = true;
+	release(task_id);
+	stream.setWindow(nullptr, nullptr);
+}
+
+void BinaryTraceReader::release(int task_id)
+{
+	actionvec_t().swap(windows[task_id]);
+}
+
+// True if any read or record check failed after open. The affected tasks saw their actions end early
+bool BinaryTraceReader::hasFailed() const
+{
+	return failed;
+}
+
+bool isBinaryTraceFile(const std::string &filename)
+{
+	char magic[8];
+	FILE* file = fopen(filename.c_str(), "rb");
+	if (!file)
+		return false;
+	size_t read = fread(magic, 1, sizeof(magic), file);
+	fclose(file);
+	return read == sizeof(magic) && memcmp(magic, BINARY_TRACE_MAGIC, sizeof(magic)) == 0;
+}
+
+// The actions are grouped per task with an ActionTable, then written header first, records last
+bool writeBinaryTrace(const std::string &filename, const TraceInput &input, ParseError &error)
+{
+	const ActionTable action_table(input.num_tasks, input.actions);
+
+	BinaryTraceHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, BINARY_TRACE_MAGIC, sizeof(header.magic));
+	header.version = BINARY_TRACE_VERSION;
+	header.byte_order = BINARY_TRACE_BYTE_ORDER;
+	header.record_size = sizeof(Action);
+	header.num_tasks = input.num_tasks;
+	header.num_resources = input.num_resources;
+	header.num_actions = action_table.getNumActions();
+
+	std::vector<int32_t> offsets(input.num_tasks + 1, 0);
+	for (int i = 0; i < input.num_tasks; i++)
+	{
+		offsets[i + 1] = offsets[i] + action_table.getStream(i).remaining();
+	}
+
+	FILE* file = fopen(filename.c_str(), "wb");
+	if (!file)
+	{
+		setError(error, "unable to open file for writing");
+		return false;
+	}
+
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+	ok = ok && fwrite(input.resources.data(), sizeof(int32_t), input.num_resources, file) == (size_t)input.num_resources;
+	ok = ok && fwrite(offsets.data(), sizeof(int32_t), offsets.size(), file) == offsets.size();
+	for (int i = 0; ok && i < input.num_tasks; i++)
+	{
+		for (ActionStream stream = action_table.getStream(i); ok && !stream.exhausted(); stream.advance())
+		{
+			const Action* action = stream.current();
+			// terminate's resource is never read; storing it as -1 keeps every written record valid
+			int resource_id = action->getType() == TERMINATE ? -1 : action->getResourceId();
+			int32_t record[5] = { (int32_t)action->getType(), action->getTaskId(), action->getDelay(),
+					resource_id, action->getAmount() };
+			ok = fwrite(record, sizeof(record), 1, file) == 1;
+		}
+	}
+
+	ok = (fclose(file) == 0) && ok;
+	if (!ok)
+	{
+		setError(error, "unable to write " + filename);
+	}
+	return ok;
+}
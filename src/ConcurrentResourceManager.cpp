@@ -0,0 +1,149 @@
+#include "concurrent_manager.h"
+
+using namespace std;
+
+// What one live or one parked task adds to counts
+#define COUNT_PARKED 1ULL
+#define COUNT_LIVE (1ULL << 32)
+
+// Every live task is parked, so none of them can release anything
+static bool everyLiveParked(unsigned long long counts)
+{
+	unsigned long long live = counts >> 32;
+	return live > 0 && (counts & (COUNT_LIVE - 1)) == live;
+}
+
+// Slots are allocated one by one, like the pool's worker queues, so threads working on different resources
+// mostly don't share cache lines
+ConcurrentResourceManager::ConcurrentResourceManager(int num_tasks, const vector<int> &units) :
+	ParkingManager<ConcurrentResourceManager>(num_tasks, units), counts(0)
+{
+	for (int i = 0; i < num_resources; i++)
+	{
+		unique_ptr<ResourceSlot> resource(new ResourceSlot());
+		resource->available = units[i];
+		resource->waiters = 0;
+		resource->waiting.head = resource->waiting.tail = -1;
+		resources.push_back(move(resource));
+	}
+}
+
+// CAS loop: take the units if there are enough, without a lock
+bool ConcurrentResourceManager::takeUnits(int resource_id, int amount)
+{
+	ResourceSlot &resource = *resources[resource_id];
+	int available = resource.available.load();
+	while (available >= amount)
+	{
+		if (resource.available.compare_exchange_weak(available, available - amount))
+			return true;
+	}
+	return false;
+}
+
+decision_t ConcurrentResourceManager::tryRequest(int task_id, int resource_id, int amount)
+{
+	if (!validAction(task_id, resource_id) || amount < 0)
+		return DECISION_INVALID;
+	if (resources[resource_id]->waiters.load() == 0 && takeUnits(resource_id, amount))
+	{
+		grant(task_id, resource_id, amount);
+		return DECISION_GRANTED;
+	}
+	tasks[task_id]->blocks++;
+	return DECISION_BLOCKED;
+}
+
+decision_t ConcurrentResourceManager::request(int task_id, int resource_id, int amount)
+{
+	if (!validAction(task_id, resource_id) || amount < 0)
+		return DECISION_INVALID;
+	if (resources[resource_id]->waiters.load() == 0 && takeUnits(resource_id, amount))
+	{
+		grant(task_id, resource_id, amount);
+		return DECISION_GRANTED;
+	}
+	return park(task_id, resource_id, amount);
+}
+
+// Count this task as a waiter before available is looked at again; a release adds its units before it looks at
+// waiters, so either the units are seen here or the release sees this waiter. Then park as usual
+decision_t ConcurrentResourceManager::park(int task_id, int resource_id, int amount)
+{
+	ResourceSlot &resource = *resources[resource_id];
+	unique_lock<mutex> guard(resource.lock);
+	resource.waiters++;
+	wakeWaiters(resource_id);
+	if (takeUnits(resource_id, amount))
+	{
+		resource.waiters--;
+		guard.unlock();
+		grant(task_id, resource_id, amount);
+		return DECISION_GRANTED;
+	}
+	return ParkingManager<ConcurrentResourceManager>::park(guard, task_id, resource_id, amount);
+}
+
+mutex &ConcurrentResourceManager::lockOf(int resource_id)
+{
+	return resources[resource_id]->lock;
+}
+
+ConcurrentResourceManager::WaitList &ConcurrentResourceManager::waitListOf(int resource_id)
+{
+	return resources[resource_id]->waiting;
+}
+
+int ConcurrentResourceManager::unitsAvailable(int resource_id)
+{
+	return resources[resource_id]->available.load();
+}
+
+// Units come back at once; the lock is only taken if someone is waiting for them
+void ConcurrentResourceManager::giveBack(int resource_id, int amount)
+{
+	ResourceSlot &resource = *resources[resource_id];
+	resource.available += amount;
+	if (resource.waiters.load() > 0)
+	{
+		lock_guard<mutex> guard(resource.lock);
+		wakeWaiters(resource_id);
+	}
+}
+
+void ConcurrentResourceManager::countStarted()
+{
+	counts += COUNT_LIVE;
+}
+
+bool ConcurrentResourceManager::countParked(int)
+{
+	return everyLiveParked(counts += COUNT_PARKED);
+}
+
+void ConcurrentResourceManager::countWoken(int resource_id)
+{
+	resources[resource_id]->waiters--;
+	counts -= COUNT_PARKED;
+}
+
+void ConcurrentResourceManager::countAborted(int resource_id)
+{
+	resources[resource_id]->waiters--;
+	counts -= COUNT_LIVE + COUNT_PARKED;
+}
+
+bool ConcurrentResourceManager::countEnded()
+{
+	return everyLiveParked(counts -= COUNT_LIVE);
+}
+
+bool ConcurrentResourceManager::allParked()
+{
+	return everyLiveParked(counts.load());
+}
+
+int ConcurrentResourceManager::getAvailable(int resource_id) const
+{
+	return resources[resource_id]->available.load();
+}
@@ -0,0 +1,129 @@
+#include "online_allocator.h"
+#include "resalloc.h"
+
+using namespace std;
+
+EmbeddedAllocator::EmbeddedAllocator() :
+	allocator(nullptr), last_error("")
+{
+}
+
+EmbeddedAllocator::~EmbeddedAllocator()
+{
+	delete allocator;
+}
+
+bool EmbeddedAllocator::configure(bool use_banker, int num_tasks, const vector<int> &units)
+{
+	if (num_tasks <= 0)
+	{
+		last_error = "number of tasks must be positive";
+		return false;
+	}
+	if (units.empty())
+	{
+		last_error = "at least one resource type is needed";
+		return false;
+	}
+	for (unsigned int i = 0; i < units.size(); i++)
+	{
+		if (units[i] <= 0)
+		{
+			last_error = "units of each resource type must be positive";
+			return false;
+		}
+	}
+	delete allocator;
+	allocator = new OnlineAllocator(use_banker, num_tasks, units);
+	return true;
+}
+
+bool EmbeddedAllocator::reset(int num_tasks)
+{
+	if (!checkConfigured())
+		return false;
+	if (num_tasks <= 0)
+	{
+		last_error = "number of tasks must be positive";
+		return false;
+	}
+	allocator->reset(num_tasks);
+	return true;
+}
+
+decision_t EmbeddedAllocator::initiate(int task_id, int resource_id, int claim)
+{
+	if (!checkConfigured())
+		return DECISION_INVALID;
+	return decided(allocator->initiate(task_id, resource_id, claim));
+}
+
+decision_t EmbeddedAllocator::request(int task_id, int resource_id, int amount)
+{
+	if (!checkConfigured())
+		return DECISION_INVALID;
+	return decided(allocator->request(task_id, resource_id, amount));
+}
+
+decision_t EmbeddedAllocator::release(int task_id, int resource_id, int amount)
+{
+	if (!checkConfigured())
+		return DECISION_INVALID;
+	return decided(allocator->release(task_id, resource_id, amount));
+}
+
+decision_t EmbeddedAllocator::terminate(int task_id)
+{
+	if (!checkConfigured())
+		return DECISION_INVALID;
+	return decided(allocator->terminate(task_id));
+}
+
+int EmbeddedAllocator::tick(vector<int> &granted, vector<int> &aborted)
+{
+	if (!checkConfigured())
+		return -1;
+	return allocator->tick(granted, aborted);
+}
+
+bool EmbeddedAllocator::checkConfigured()
+{
+	if (allocator != nullptr)
+		return true;
+	last_error = "allocator is not configured";
+	return false;
+}
+
+// Keep the allocator's reason for an invalid action as this call's error
+decision_t EmbeddedAllocator::decided(decision_t decision)
+{
+	if (decision == DECISION_INVALID)
+		last_error = allocator->getLastError();
+	return decision;
+}
+
+bool EmbeddedAllocator::isConfigured() const
+{
+	return allocator != nullptr;
+}
+
+int EmbeddedAllocator::getCycle() const
+{
+	return allocator != nullptr ? allocator->getCycle() : 0;
+}
+
+int EmbeddedAllocator::getNumTasks() const
+{
+	return allocator != nullptr ? allocator->getNumTasks() : 0;
+}
+
+int EmbeddedAllocator::getNumResources() const
+{
+	return allocator != nullptr ? allocator->getNumResources() : 0;
+}
+
+// Why the last call failed or returned DECISION_INVALID
+const char* EmbeddedAllocator::getLastError() const
+{
+	return last_error;
+}
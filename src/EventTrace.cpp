@@ -0,0 +1,209 @@
+#include <chrono>
+#include <iostream>
+#include <string.h>
+#include "event_trace.h"
+
+using namespace std;
+
+static_assert(sizeof(EventTraceHeader) == 24, "EventTraceHeader must not be padded");
+static_assert(sizeof(TraceEvent) == 6 * sizeof(int32_t), "TraceEvent must not be padded");
+static_assert((EVENT_RING_SIZE & (EVENT_RING_SIZE - 1)) == 0, "EVENT_RING_SIZE must be a power of two");
+
+EventTracer::EventTracer() : head(0), tail(0), stopping(false), failed(false), file(nullptr)
+{
+}
+
+EventTracer::~EventTracer()
+{
+	close();
+}
+
+// Write the header and start the flusher. Returns false if the file can't be written
+bool EventTracer::open(const string &filename, trace_manager_t manager)
+{
+	close();
+	file = fopen(filename.c_str(), "wb");
+	if (!file)
+		return false;
+
+	EventTraceHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, EVENT_TRACE_MAGIC, sizeof(header.magic));
+	header.version = EVENT_TRACE_VERSION;
+	header.record_size = sizeof(TraceEvent);
+	header.manager = manager;
+	if (fwrite(&header, sizeof(header), 1, file) != 1)
+	{
+		fclose(file);
+		file = nullptr;
+		return false;
+	}
+
+	ring.resize(EVENT_RING_SIZE);
+	head.store(0);
+	tail.store(0);
+	stopping.store(false);
+	failed.store(false);
+	flusher = thread(&EventTracer::flushLoop, this);
+	return true;
+}
+
+// Called only from the thread running the traced manager. Waits for the flusher if the ring is full
+void EventTracer::record(int cycle, trace_event_t type, int task, int resource, int amount, int extra)
+{
+	uint64_t position = head.load(memory_order_relaxed);
+	while (position - tail.load(memory_order_acquire) >= EVENT_RING_SIZE)
+	{
+		this_thread::yield();
+	}
+	TraceEvent &event = ring[position & (EVENT_RING_SIZE - 1)];
+	event.cycle = cycle;
+	event.task = task;
+	event.type = type;
+	event.resource = resource;
+	event.amount = amount;
+	event.extra = extra;
+	head.store(position + 1, memory_order_release);
+}
+
+// Write out whatever has been recorded, in at most two contiguous pieces of the ring, until stopped and empty
+void EventTracer::flushLoop()
+{
+	while (true)
+	{
+		bool last_pass = stopping.load(memory_order_acquire);
+		uint64_t start = tail.load(memory_order_relaxed);
+		uint64_t end = head.load(memory_order_acquire);
+		if (start == end)
+		{
+			if (last_pass)
+				break;
+			this_thread::sleep_for(chrono::microseconds(200));
+			continue;
+		}
+
+		while (start < end)
+		{
+			uint64_t offset = start & (EVENT_RING_SIZE - 1);
+			uint64_t count = min(end - start, (uint64_t)EVENT_RING_SIZE - offset);
+			if (!failed.load(memory_order_relaxed) && fwrite(&ring[offset], sizeof(TraceEvent), count, file) != count)
+			{
+				failed.store(true);
+			}
+			start += count;
+			tail.store(start, memory_order_release);
+		}
+	}
+}
+
+// Drain the ring, stop the flusher and close the file. Returns false if anything failed to be written
+bool EventTracer::close()
+{
+	if (!file)
+		return !failed.load();
+
+	stopping.store(true, memory_order_release);
+	flusher.join();
+	if (fclose(file) != 0)
+	{
+		failed.store(true);
+	}
+	file = nullptr;
+	return !failed.load();
+}
+
+bool EventTracer::hasFailed() const
+{
+	return failed.load();
+}
+
+// The text each event stood for when tracing was done with #ifdef DEBUG output. Ids are printed 1-based
+static void printEvent(const TraceEvent &event, ostream &out)
+{
+	int task = event.task + 1;
+	int resource = event.resource + 1;
+	switch (event.type)
+	{
+	case TRACE_CYCLE:
+		out << "Cycle " << event.cycle << " - " << event.cycle + 1 << "\n";
+		break;
+	case TRACE_SKIP:
+		out << "Skipping idle cycles " << event.cycle << " - " << event.extra << "\n";
+		break;
+	case TRACE_INITIATE:
+		out << "At cycle " << event.cycle << " - " << event.cycle + 1 << " Task # " << task
+				<< " was initialized with claim " << event.amount << " of resource " << resource << "\n";
+		break;
+	case TRACE_COMPUTING:
+		out << "Task # " << task << " is computing (" << event.amount << " of " << event.extra << " cycles).\n";
+		break;
+	case TRACE_DELAYED:
+		out << "Task # " << task << " is delayed (" << event.amount << " of " << event.extra << " cycles).\n";
+		break;
+	case TRACE_REFUSED:
+		out << " Task # " << task << " could not be granted its resource!\n";
+		break;
+	case TRACE_GRANTED:
+		out << " Task # " << task << " was granted " << event.amount << " of resource " << resource
+				<< ". It now holds " << event.extra << " of that resource.\n";
+		break;
+	case TRACE_RELEASED:
+		out << " Task # " << task << " is releasing " << event.amount << " of resource " << resource
+				<< ". It now holds " << event.extra << " of that resource.\n";
+		break;
+	case TRACE_TERMINATED:
+		out << " Task # " << task << " is terminated. \n";
+		break;
+	case TRACE_DEADLOCK_ABORT:
+		out << "Task # " << task << " was aborted due to deadlock.\n" << "Releasing ";
+		break;
+	case TRACE_ABORT_RELEASE:
+		out << event.amount << " of resource " << resource << " \n";
+		break;
+	case TRACE_CLAIM_ABORT:
+		out << "Banker aborts task # " << task << " before run begins: \n"
+				<< "\tclaim for resource " << resource << " (" << event.amount << ") exceeds number of units present: "
+				<< event.extra << ".\n";
+		break;
+	case TRACE_REQUEST_ABORT:
+		out << "Task # " << task << " request exceeded claim. Aborted!\n";
+		break;
+	default:
+		out << "Unknown event " << event.type << " at cycle " << event.cycle << "\n";
+		break;
+	}
+}
+
+bool decodeEventTraces(const vector<string> &filenames, ostream &out)
+{
+	vector<TraceEvent> events(4096);
+	for (unsigned int i = 0; i < filenames.size(); i++)
+	{
+		FILE* file = fopen(filenames[i].c_str(), "rb");
+		if (!file)
+		{
+			cerr << "Unable to open " << filenames[i] << "\n";
+			return false;
+		}
+
+		EventTraceHeader header;
+		if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, EVENT_TRACE_MAGIC, sizeof(header.magic)) != 0
+				|| header.version != EVENT_TRACE_VERSION || header.record_size != sizeof(TraceEvent))
+		{
+			cerr << filenames[i] << " is not an event trace (or is from an incompatible version)\n";
+			fclose(file);
+			return false;
+		}
+
+		size_t count;
+		while ((count = fread(events.data(), sizeof(TraceEvent), events.size(), file)) > 0)
+		{
+			for (size_t j = 0; j < count; j++)
+			{
+				printEvent(events[j], out);
+			}
+		}
+		fclose(file);
+	}
+	return true;
+}
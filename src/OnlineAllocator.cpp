@@ -0,0 +1,254 @@
+#include "online_allocator.h"
+
+using namespace std;
+
+// Only the manager in use is sized; the other stays empty
+OnlineAllocator::OnlineAllocator(bool use_banker, int num_tasks, const vector<int> &resource_units) :
+	banker(use_banker), optimistic_manager(0, 0, nullptr), banker_manager(0, 0, nullptr),
+	units(resource_units), discard(nullptr), last_error("")
+{
+	if (banker)
+		manager = &banker_manager;
+	else
+		manager = &optimistic_manager;
+	manager->setOutput(discard);
+	banker_manager.setClaimsAgainstTotal(true);
+	reset(num_tasks);
+}
+
+// Start over with every unit available and num_tasks new tasks
+void OnlineAllocator::reset(int num_tasks)
+{
+	if (banker)
+		banker_manager.reinitialize(units.size(), num_tasks, units.data());
+	else
+		optimistic_manager.reinitialize(units.size(), num_tasks, units.data());
+
+	tasks.clear();
+	tasks.reserve(num_tasks);
+	for (int i = 0; i < num_tasks; i++)
+	{
+		tasks.push_back(Task(manager->getAllocations(), manager->getTaskCounters(), i));
+	}
+	pending.assign(num_tasks, Action(TERMINATE, 0, 0, -1, 0));
+
+	// The Banker never looks for deadlocks, so only FIFO needs to leave unused tasks out
+	started.assign(num_tasks, banker);
+	for (int i = 0; i < num_tasks && !banker; i++)
+	{
+		optimistic_manager.deferTask(i);
+	}
+}
+
+// A task can take an action if it exists, hasn't finished and isn't waiting on a request
+bool OnlineAllocator::checkTask(int task_id)
+{
+	if (task_id < 0 || task_id >= (int)tasks.size())
+		last_error = "no such task";
+	else if (tasks[task_id].isAborted())
+		last_error = "task was aborted";
+	else if (tasks[task_id].isDoneOrAborted())
+		last_error = "task has terminated";
+	else if (tasks[task_id].isBlocked())
+		last_error = "task is blocked on a request";
+	else
+		return true;
+	return false;
+}
+
+bool OnlineAllocator::checkResource(int resource_id)
+{
+	if (resource_id >= 0 && resource_id < (int)units.size())
+		return true;
+	last_error = "no such resource";
+	return false;
+}
+
+decision_t OnlineAllocator::initiate(int task_id, int resource_id, int claim)
+{
+	if (!checkTask(task_id) || !checkResource(resource_id))
+		return DECISION_INVALID;
+	if (claim < 0)
+	{
+		last_error = "claim is negative";
+		return DECISION_INVALID;
+	}
+	if (claim < tasks[task_id].getResourceHeld(resource_id))
+	{
+		last_error = "claim is less than the task holds";
+		return DECISION_INVALID;
+	}
+	return dispatch(Action(INITIATE, task_id, 0, resource_id, claim));
+}
+
+decision_t OnlineAllocator::request(int task_id, int resource_id, int amount)
+{
+	if (!checkTask(task_id) || !checkResource(resource_id))
+		return DECISION_INVALID;
+	if (amount < 0)
+	{
+		last_error = "amount is negative";
+		return DECISION_INVALID;
+	}
+	return dispatch(Action(REQUEST, task_id, 0, resource_id, amount));
+}
+
+// Released units can be granted from the next tick on
+decision_t OnlineAllocator::release(int task_id, int resource_id, int amount)
+{
+	if (!checkTask(task_id) || !checkResource(resource_id))
+		return DECISION_INVALID;
+	if (amount < 0 || amount > tasks[task_id].getResourceHeld(resource_id))
+	{
+		last_error = "amount is more than the task holds";
+		return DECISION_INVALID;
+	}
+	return dispatch(Action(RELEASE, task_id, 0, resource_id, amount));
+}
+
+// Input files release everything before terminating, but a client may not, so whatever is still held is
+// released first (and comes back at the next tick, like any release)
+decision_t OnlineAllocator::terminate(int task_id)
+{
+	if (!checkTask(task_id))
+		return DECISION_INVALID;
+	for (int resource_id = 0; resource_id < (int)units.size(); resource_id++)
+	{
+		int held = tasks[task_id].getResourceHeld(resource_id);
+		if (held > 0)
+			dispatch(Action(RELEASE, task_id, 0, resource_id, held));
+	}
+	return dispatch(Action(TERMINATE, task_id, 0, -1, 0));
+}
+
+// Make the action the task's only one and dispatch it now. It has no delay, so it completes (or blocks) at once
+decision_t OnlineAllocator::dispatch(const Action &action)
+{
+	int id = action.getTaskId();
+	if (!started[id])
+	{
+		started[id] = true;
+		optimistic_manager.startTask(id);
+	}
+	pending[id] = action;
+	Task &task = tasks[id];
+	task.bindActionStream(ActionStream(&pending[id], &pending[id] + 1));
+	dispatchRunnable(task);
+	if (task.isAborted())
+		return DECISION_ABORTED;
+	if (task.isBlocked())
+		return DECISION_BLOCKED;
+	return action.getType() == REQUEST ? DECISION_GRANTED : DECISION_OK;
+}
+
+// End the current cycle: resolve a deadlock (FIFO), commit released units and retry blocked requests.
+// The ids of the tasks whose requests were granted, and of those aborted, are appended. Returns the new cycle
+int OnlineAllocator::tick(vector<int> &granted, vector<int> &aborted)
+{
+	// Deadlock victims are the lowest-id live tasks, so keep the live ids in case every one is blocked
+	if (!banker)
+	{
+		live_ids.clear();
+		if (manager->getTaskCounters().runnable == 0)
+		{
+			const TaskQueue &live_tasks = manager->getLiveTasks();
+			for (int id = live_tasks.front(); id >= 0; id = live_tasks.nextOf(id))
+			{
+				live_ids.push_back(id);
+			}
+		}
+		int victims = optimistic_manager.resolveDeadlock(tasks);
+		aborted.insert(aborted.end(), live_ids.begin(), live_ids.begin() + victims);
+	}
+	manager->commitReleasedResources();
+	manager->incrementCycle();
+	retryBlocked(granted);
+	return manager->getCycle();
+}
+
+// The Banker gets the loop with the resource count fixed, as in Simulation::runBanker
+void OnlineAllocator::dispatchRunnable(Task &task)
+{
+	if (!banker)
+	{
+		optimistic_manager.dispatchRunnable<0>(task);
+		return;
+	}
+	switch (units.size())
+	{
+	case 1:
+		banker_manager.dispatchRunnable<1>(task);
+		break;
+	case 2:
+		banker_manager.dispatchRunnable<2>(task);
+		break;
+	case 3:
+		banker_manager.dispatchRunnable<3>(task);
+		break;
+	case 4:
+		banker_manager.dispatchRunnable<4>(task);
+		break;
+	default:
+		banker_manager.dispatchRunnable<0>(task);
+		break;
+	}
+}
+
+void OnlineAllocator::retryBlocked(vector<int> &woken)
+{
+	if (!banker)
+	{
+		optimistic_manager.retryBlocked<0>(tasks, woken);
+		return;
+	}
+	switch (units.size())
+	{
+	case 1:
+		banker_manager.retryBlocked<1>(tasks, woken);
+		break;
+	case 2:
+		banker_manager.retryBlocked<2>(tasks, woken);
+		break;
+	case 3:
+		banker_manager.retryBlocked<3>(tasks, woken);
+		break;
+	case 4:
+		banker_manager.retryBlocked<4>(tasks, woken);
+		break;
+	default:
+		banker_manager.retryBlocked<0>(tasks, woken);
+		break;
+	}
+}
+
+int OnlineAllocator::getCycle()
+{
+	return manager->getCycle();
+}
+
+int OnlineAllocator::getNumTasks()
+{
+	return tasks.size();
+}
+
+int OnlineAllocator::getNumResources()
+{
+	return units.size();
+}
+
+// Tasks waiting for a tick to grant (or abort) their request
+int OnlineAllocator::getNumBlocked()
+{
+	return manager->getTaskCounters().blocked;
+}
+
+bool OnlineAllocator::isBanker()
+{
+	return banker;
+}
+
+// Why the last action was DECISION_INVALID
+const char* OnlineAllocator::getLastError()
+{
+	return last_error;
+}
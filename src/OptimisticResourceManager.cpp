@@ -8,18 +8,28 @@
 #include <assert.h>
 #include <iostream>
 #include "data_types.h"
+#include "event_trace.h"
+#include "policy_manager.h"
+#include "run_stats.h"
+#include "simd_kernels.h"
 
 using namespace std;
 
-static bool compareTasksForSort(const Task &a, const Task &b);
-
 OptimisticResourceManager::OptimisticResourceManager(int num_resources, int tasks, int* resources_initial) :
-	ResourceManager(num_resources, tasks, resources_initial) {}
+	PolicyResourceManager(num_resources, tasks, resources_initial), pending_available(num_resources, 0) {}
+
+void OptimisticResourceManager::reinitialize(int n_resources, int tasks, int* resources_initial)
+{
+	ResourceManager::reinitialize(n_resources, tasks, resources_initial);
+	pending_available.assign(n_resources, 0);
+}
 
-// For each cycle, for each task, dispatch the appropriate action
+// For each cycle, for each task, dispatch the appropriate action. A request only depends on the units left of
+// the resource it asks for, so nothing here loops over resources and N makes no difference
+template <int N>
 void OptimisticResourceManager::dispatchAction(Task& task)
 {
-	const Action action = *task.getActionPointer();
+	const Action &action = *task.getActionPointer();
 	switch(action.getType())
 	{
 	case(INITIATE):
@@ -47,11 +57,8 @@ void OptimisticResourceManager::dispatchInitiate(const Action &action, Task& tas
 
 	task.setTimeCreated(getCycle());
 	task.setResourceClaimed(action.getResourceId(), action.getAmount());
-#ifdef DEBUG
-	std::cout << "At cycle " << getCycle() << " - " << getCycle() + 1 <<
-					" Task # " << task.getId() + 1 << " was initialized with claim "
-					<< action.getAmount() << " of resource " << resource_id + 1 << "\n";
-#endif
+	if (getTracer())
+		getTracer()->record(getCycle(), TRACE_INITIATE, task.getId(), resource_id, action.getAmount(), 0);
 }
 
 // For a request, if there's a delay, increment the delay counter until delay == action.delay
@@ -63,13 +70,10 @@ void OptimisticResourceManager::dispatchRequest(const Action &action, Task& task
 	int requested_resource_id = action.getResourceId();
 	int amount_requested = action.getAmount();
 
-	if (task.getDelay() < action.getDelay())
+	if (isComputing(action, task))
 	{
-		task.incrementDelay();
-#ifdef DEBUG
-		std::cout << "Task # " << task.getId() + 1 << " is computing (" << task.getDelay() <<
-				" of " << action.getDelay() << " cycles).\n";
-#endif
+		if (getTracer())
+			getTracer()->record(getCycle(), TRACE_COMPUTING, task.getId(), -1, task.getDelay(), action.getDelay());
 	}
 	else
 	{
@@ -79,10 +83,11 @@ void OptimisticResourceManager::dispatchRequest(const Action &action, Task& task
 			{
 				task.block();
 				task.setBlockedSince(getCycle());
+				if (getStats())
+					getStats()->blocks++;
 			}
-#ifdef DEBUG
-			std::cout << " Task # " << task.getId() + 1<< " could not be granted its resource!\n";
-#endif
+			if (getTracer())
+				getTracer()->record(getCycle(), TRACE_REFUSED, task.getId(), requested_resource_id, amount_requested, 0);
 		}
 		else
 		{
@@ -90,11 +95,11 @@ void OptimisticResourceManager::dispatchRequest(const Action &action, Task& task
 			task.setDelay(0);
 			task.grantResources(requested_resource_id, amount_requested);
 			decrementResourcesAvailable(requested_resource_id, amount_requested);
-#ifdef DEBUG
-			std::cout << " Task # " << task.getId() + 1 << " was granted " << amount_requested <<
-					" of resource " << requested_resource_id + 1 << ". It now holds " <<
-					task.getResourceHeld(requested_resource_id) << " of that resource.\n";
-#endif
+			if (getStats())
+				getStats()->grants++;
+			if (getTracer())
+				getTracer()->record(getCycle(), TRACE_GRANTED, task.getId(), requested_resource_id, amount_requested,
+						task.getResourceHeld(requested_resource_id));
 		}
 	}
 }
@@ -108,13 +113,10 @@ void OptimisticResourceManager::dispatchRelease(const Action &action, Task& task
 	int released_resource_id = action.getResourceId();
 	int amount_released = action.getAmount();
 
-	if (task.getDelay() < action.getDelay())
+	if (isComputing(action, task))
 	{
-		task.incrementDelay();
-#ifdef DEBUG
-		std::cout << "Task # " << task.getId() + 1 << " is computing (" << task.getDelay() <<
-						" of " << action.getDelay() << " cycles).\n";
-#endif
+		if (getTracer())
+			getTracer()->record(getCycle(), TRACE_COMPUTING, task.getId(), -1, task.getDelay(), action.getDelay());
 	}
 	else
 	{
@@ -122,11 +124,9 @@ void OptimisticResourceManager::dispatchRelease(const Action &action, Task& task
 		task.setDelay(0);
 		task.releaseResources(released_resource_id, amount_released);
 		incrementResourcesAvailable(released_resource_id, amount_released);
-#ifdef DEBUG
-		std::cout << " Task # " << task.getId() + 1 << " is releasing " << amount_released <<
-				" of resource " << released_resource_id + 1 << ". It now holds " <<
-				task.getResourceHeld(released_resource_id) << " of that resource.\n";
-#endif
+		if (getTracer())
+			getTracer()->record(getCycle(), TRACE_RELEASED, task.getId(), released_resource_id, amount_released,
+					task.getResourceHeld(released_resource_id));
 	}
 
 }
@@ -138,117 +138,178 @@ void OptimisticResourceManager::dispatchTerminate(const Action &action, Task& ta
 {
 	assert (task.getId() == action.getTaskId());
 	assert (!task.isDoneOrAborted());
-	if (task.getDelay() < action.getDelay())
+	if (isComputing(action, task))
 	{
-		task.incrementDelay();
-#ifdef DEBUG
-		std::cout << "Task # " << task.getId() + 1 << " is computing (" << task.getDelay() <<
-						" of " << action.getDelay() << " cycles).\n";
-#endif
+		if (getTracer())
+			getTracer()->record(getCycle(), TRACE_COMPUTING, task.getId(), -1, task.getDelay(), action.getDelay());
 	}
 	else
 	{
 		task.setDelay(0);
 		task.setTimeTerminated(getCycle());
-#ifdef DEBUG
-		std::cout << " Task # " << task.getId() + 1 << " is terminated. \n";
-#endif
+		if (getTracer())
+			getTracer()->record(getCycle(), TRACE_TERMINATED, task.getId(), -1, 0, 0);
 	}
 }
 
 // Checks for deadlock, and aborts the lowest process in the case that deadlock is found
-// In the case of deadlock, sort the processes by the order it appeared in the list (task ID)
-// Then, find the first process that's not done or aborted, and abort it by setting time terminated to now
+// In the case of deadlock, find the first process that's not done or aborted (live tasks are kept in task ID order),
+// and abort it by setting time terminated to now
 // Also set the aborted flag so we can print accurate info at the end
 bool OptimisticResourceManager::handleDeadlock(vector<Task> &tasklist)
 {
 	bool ret_val = false;
-	// Sort the tasklist by ID so we can kill off the 1st process that's deadlocking, then 2nd, etc
-	// Then check if there's deadlock
-	int resource = 0;
-	std::sort(tasklist.begin(), tasklist.end(), compareTasksForSort);
-	if (detectDeadlock(tasklist))
+	if (detectDeadlock())
 	{
 		ret_val = true;
-		for (auto it = tasklist.begin(); it != tasklist.end(); it++)
+		int id = getLiveTasks().front();
+		if (id >= 0)
 		{
-			if (!it->isDoneOrAborted())
-			{
-				it->setTimeTerminated(getCycle());
-#ifdef DEBUG
-				std::cout << "Task # " << it->getId() + 1 << " was aborted due to deadlock.\n";
-				std::cout << "Releasing ";
-#endif
-				for (int i = 0; i < getNumResources(); i++)
-				{
-					resource = it->getResourceHeld(i);
-					if (resource > 0)
-					{
-#ifdef DEBUG
-						std::cout << resource << " of resource " << i + 1 << " \n";
-#endif
-						it->releaseResources(i, resource);
-						incrementResourcesAvailable(i, resource);
-					}
-				}
-				it->abort();
-				it->unblock();
-				break;
-			}
+			abortForDeadlock(tasklist[id]);
 		}
 	}
 	return ret_val;
 }
 
-// If all processes are blocked, return true. Else return false
-bool OptimisticResourceManager::detectDeadlock(vector<Task> &tasklist)
+// Abort a deadlocked task: terminate it now and release everything it holds (available from next cycle)
+void OptimisticResourceManager::abortForDeadlock(Task &task)
 {
-	for (auto it = tasklist.begin(); it != tasklist.end(); it++)
+	int resource = 0;
+	int id = task.getId();
+	task.setTimeTerminated(getCycle());
+	if (getTracer())
+		getTracer()->record(getCycle(), TRACE_DEADLOCK_ABORT, id, -1, 0, 0);
+	const int* held = getAllocations().heldRow(id);
+	for (int i = 0; i < getNumResources(); i++)
 	{
-		if (!it->isBlocked() && !it->isDoneOrAborted())
+		resource = held[i];
+		if (resource > 0)
 		{
-			return false;
+			if (getTracer())
+				getTracer()->record(getCycle(), TRACE_ABORT_RELEASE, id, i, resource, 0);
+			task.releaseResources(i, resource);
+			incrementResourcesAvailable(i, resource);
 		}
 	}
-	return true;
+	task.abort();
+	task.unblock();
+	retireTask(task);
 }
 
-// Cycle through all tasks and do the following. First set new_resources to the number of available resources
-// Take into account any releases or abort releases that happened that cycle but that haven't been committed yet
-// See if any action can be satisfied by this newly available set of resources. If yes, return true. Else return false
-bool OptimisticResourceManager::canSatisfyAnyRequest( taskvec_t &tasklist)
+// Resolve a deadlock in one go, with the same victims as calling handleDeadlock until canSatisfyAnyRequest
+// (or until no task is left): the lowest-id live tasks, as few as needed for some remaining request to fit.
+// Returns the number of tasks aborted
+int OptimisticResourceManager::resolveDeadlock(taskvec_t &tasklist)
 {
-	bool ret_val = false;
+	if (!detectDeadlock())
+		return 0;
 
-	int* new_resources = new int[getNumResources()];
-	for (int i = 0; i < getNumResources(); i++)
+	int victims = countDeadlockVictims();
+	if (getStats() && victims > 0)
+	{
+		getStats()->deadlocks++;
+		getStats()->deadlock_victims += victims;
+	}
+	for (int i = 0; i < victims; i++)
 	{
-		new_resources[i] = getResourcesAvailable(i) + getResourcesChanged(i);
+		abortForDeadlock(tasklist[getLiveTasks().front()]);
 	}
+	return victims;
+}
+
+// Every live task is blocked. Bucket their requests by resource; walking the live tasks in id order keeps each
+// bucket sorted by id, and a suffix minimum over each bucket gives the smallest request among the tasks after
+// any point. Then take victims in id order, adding what each holds to the pending units. After a victim, the
+// remaining waiters on a resource are the bucket past a cursor that only moves forward; only resources the
+// victim released can have become satisfiable, since for every other resource the suffix minimum can only
+// have grown. O(live tasks * resources) overall, where repeated handleDeadlock/canSatisfyAnyRequest is
+// O(live tasks^2)
+int OptimisticResourceManager::countDeadlockVictims()
+{
+	const TaskQueue &live_tasks = getLiveTasks();
+	const int* waiting_resources = getWaitingResources();
+	const int* waiting_amounts = getWaitingAmounts();
+	int num_resources = getNumResources();
 
-	int current_request = 0;
+	waiter_start.assign(num_resources + 1, 0);
+	for (int id = live_tasks.front(); id >= 0; id = live_tasks.nextOf(id))
+	{
+		waiter_start[waiting_resources[id] + 1]++;
+	}
+	for (int i = 0; i < num_resources; i++)
+	{
+		waiter_start[i + 1] += waiter_start[i];
+	}
 
-	for (unsigned int i = 0; i < tasklist.size(); i++)
+	waiter_ids.resize(waiter_start[num_resources]);
+	waiter_min.resize(waiter_start[num_resources]);
+	waiter_cursor.assign(waiter_start.begin(), waiter_start.end() - 1);
+	for (int id = live_tasks.front(); id >= 0; id = live_tasks.nextOf(id))
 	{
-		if (tasklist[i].isDoneOrAborted())
+		int position = waiter_cursor[waiting_resources[id]]++;
+		waiter_ids[position] = id;
+		waiter_min[position] = waiting_amounts[id];
+	}
+	for (int i = 0; i < num_resources; i++)
+	{
+		waiter_cursor[i] = waiter_start[i];
+		for (int j = waiter_start[i + 1] - 2; j >= waiter_start[i]; j--)
 		{
-			continue;
+			waiter_min[j] = min(waiter_min[j], waiter_min[j + 1]);
 		}
-		const Action current_action = *tasklist[i].getActionPointer();
-		current_request = current_action.getAmount();
-		if (new_resources[current_action.getResourceId()] >= current_request)
+		pending_available[i] = getResourcesAvailable(i) + getResourcesChanged(i);
+	}
+
+	int victims = 0;
+	for (int id = live_tasks.front(); id >= 0; id = live_tasks.nextOf(id))
+	{
+		victims++;
+		bool satisfiable = false;
+		const int* held = getAllocations().heldRow(id);
+		for (int i = 0; i < num_resources; i++)
 		{
-			ret_val = true;
-			break;
+			if (held[i] == 0)
+				continue;
+			pending_available[i] += held[i];
+			int &cursor = waiter_cursor[i];
+			while (cursor < waiter_start[i + 1] && waiter_ids[cursor] <= id)
+			{
+				cursor++;
+			}
+			if (cursor < waiter_start[i + 1] && waiter_min[cursor] <= pending_available[i])
+			{
+				satisfiable = true;
+			}
 		}
+		if (satisfiable)
+			break;
 	}
+	return victims;
+}
 
-	delete new_resources;
-	return ret_val;
+// If all live processes are blocked, return true. Else return false
+// O(1): the task counters track how many live tasks are not blocked
+bool OptimisticResourceManager::detectDeadlock()
+{
+	return getTaskCounters().runnable == 0;
 }
 
-// Sort task function - sort by order it appears in input file (id)
-static bool compareTasksForSort(const Task &a, const Task &b)
+// First set pending_available to the number of available resources
+// Take into account any releases or abort releases that happened that cycle but that haven't been committed yet
+// See if any blocked request can be satisfied by this newly available set of resources. If yes, return true. Else return false
+// This is only called once every live task is blocked, so the waiting requests are exactly the live tasks' actions
+bool OptimisticResourceManager::canSatisfyAnyRequest()
 {
-	return a.getId() < b.getId();
+	for (int i = 0; i < getNumResources(); i++)
+	{
+		pending_available[i] = getResourcesAvailable(i) + getResourcesChanged(i);
+	}
+
+	return simdAnySatisfiable(getWaitingAmounts(), getWaitingResources(), getNumTasks(), pending_available.data());
 }
+
+// Only the runtime-sized loop is ever run; see dispatchAction
+template class PolicyResourceManager<OptimisticResourceManager>;
+template void PolicyResourceManager<OptimisticResourceManager>::dispatchCycle<0>(taskvec_t &task_list);
+template void PolicyResourceManager<OptimisticResourceManager>::dispatchRunnable<0>(Task &task);
+template void PolicyResourceManager<OptimisticResourceManager>::retryBlocked<0>(taskvec_t &task_list, vector<int> &woken);
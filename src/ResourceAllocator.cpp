@@ -1,287 +1,425 @@
-#include <algorithm>
-#include <iostream>
+#include <chrono>
 #include <fstream>
-#include <math.h>
+#include <iostream>
+#include <sstream>
+#include <stdlib.h>
 #include <string>
+#include <thread>
 #include <vector>
+#include "batch.h"
+#include "binary_trace.h"
 #include "data_types.h"
+#include "event_trace.h"
+#include "run_stats.h"
+#include "server.h"
+#include "simulation.h"
+#include "sweep.h"
+#include "trace_parser.h"
 
 using namespace std;
 
-static action_t stringToActionType(const string &str);
-static bool areAllTasksFinished(const taskvec_t &tasklist);
-static void printTaskStats(const taskvec_t &tasklist);
-static bool compareTasksForSort( const Task &a, const Task &b);
+// Actions buffered per task by --stream when no window size is given
+#define DEFAULT_STREAM_WINDOW 64
+
+// Tasks the serve allocator is sized for when --tasks isn't given; "reset <tasks>" resizes it
+#define DEFAULT_SERVE_TASKS 64
+
+static void runConcurrently(Simulation &simulation);
+static int runBatchMode(const string &path, int jobs, bool event_driven);
+static void printLoadError(const string &filename, const ParseError &error);
+static int convertTrace(const string &input_filename, const string &output_filename);
+static bool dumpStats(const string &stats_file, const RunStats &optimistic, const RunStats &banker, long long load_ns);
+static bool closeTracers(const string &trace_prefix, EventTracer &optimistic, EventTracer &banker);
+static int runServeMode(int argc, char** argv);
 
 
 int main(int argc, char** argv)
 {
-	// Set up input stream and open the file
-	string filename = "";
-	ifstream input_file;
-
-	if (argc < 2)
+	// "convert <input> <output>" writes a text input file out as a binary trace and exits
+	if (argc > 1 && string(argv[1]) == "convert")
 	{
-		filename = "./data/input-13.txt";
+		if (argc != 4)
+		{
+			cerr << "Usage: " << argv[0] << " convert <input-file> <binary-trace>\n";
+			return 1;
+		}
+		return convertTrace(argv[2], argv[3]);
 	}
-	else
+
+	// "decode <trace>..." prints --trace files as text
+	if (argc > 1 && string(argv[1]) == "decode")
 	{
-		filename = argv[1];
+		if (argc < 3)
+		{
+			cerr << "Usage: " << argv[0] << " decode <trace-file>...\n";
+			return 1;
+		}
+		return decodeEventTraces(vector<string>(argv + 2, argv + argc), cout) ? 0 : 1;
 	}
 
-	input_file.open(filename.c_str());
-	if (!input_file)
+	// "serve <socket> ..." answers allocation requests over a Unix domain socket until stopped
+	if (argc > 1 && string(argv[1]) == "serve")
 	{
-		cerr << "Unable to open " << filename << " for input. Terminating!\n";
-		return 1;
+		return runServeMode(argc, argv);
 	}
 
-	// Read in the file, get number of tasks and number of resources (and amount of each)
-	int num_tasks = 0, num_resources = 0;
-	int* resources_available = nullptr;
-	taskvec_t task_list, banker_task_list;
-	// Multidimensional vector: vector of vectors. Equivalent to Action**
-	// action_contianer[0] contains the actions for task 1, [1] for task 2, etc...
-	ActionContainer_t action_container, banker_action_container;
-
-	input_file >> num_tasks;
-	input_file >> num_resources;
-	resources_available = new int[num_resources];
-
-	for(int i = 0; i < num_tasks; i++)
+	// Set up input stream and open the file
+	string filename = "./data/input-13.txt";
+	bool event_driven = false;
+	int stream_window = 0;
+	string batch_path;
+	int jobs = thread::hardware_concurrency();
+	string sweep_range;
+	SweepOptions sweep_options = { 0, 0, 0, false, false, 0 };
+	bool collect_stats = false;
+	string stats_file;		// empty means stderr
+	string trace_prefix;	// empty means no tracing
+
+	for (int i = 1; i < argc; i++)
 	{
-		actionvec_t task_actions;
-		action_container.push_back(task_actions);
-		task_list.push_back(Task(num_resources, i));
+		string arg = argv[i];
+		if (arg == "--event")
+		{
+			event_driven = true;
+		}
+		else if (arg == "--stream")
+		{
+			stream_window = DEFAULT_STREAM_WINDOW;
+		}
+		else if (arg.compare(0, 9, "--stream=") == 0)
+		{
+			stream_window = atoi(arg.c_str() + 9);
+			if (stream_window <= 0)
+			{
+				cerr << "--stream window must be a positive number of actions\n";
+				return 1;
+			}
+		}
+		else if (arg == "--stats")
+		{
+			collect_stats = true;
+		}
+		else if (arg.compare(0, 8, "--stats=") == 0)
+		{
+			collect_stats = true;
+			stats_file = arg.substr(8);
+		}
+		else if (arg.compare(0, 8, "--trace=") == 0)
+		{
+			trace_prefix = arg.substr(8);
+			if (trace_prefix.empty())
+			{
+				cerr << "--trace needs a file prefix\n";
+				return 1;
+			}
+		}
+		else if (arg.compare(0, 8, "--batch=") == 0)
+		{
+			batch_path = arg.substr(8);
+		}
+		else if (arg.compare(0, 8, "--sweep=") == 0)
+		{
+			sweep_range = arg.substr(8);
+		}
+		else if (arg == "--sweep-each")
+		{
+			sweep_options.each_resource = true;
+		}
+		else if (arg == "--early-exit")
+		{
+			sweep_options.early_exit = true;
+		}
+		else if (arg.compare(0, 7, "--jobs=") == 0)
+		{
+			jobs = atoi(arg.c_str() + 7);
+			if (jobs <= 0)
+			{
+				cerr << "--jobs must be a positive number of threads\n";
+				return 1;
+			}
+		}
+		else
+		{
+			filename = arg;
+		}
 	}
 
-	for (int i = 0; i < num_resources; i++)
+	if (collect_stats && (!batch_path.empty() || !sweep_range.empty()))
 	{
-		input_file >> resources_available[i];
-
+		cerr << "--stats only applies to a single run, not --batch or --sweep\n";
+		return 1;
 	}
-
-	// Read in the actions
-	string action_type;
-	action_t type;
-	int task_id = 0, delay = 0, resource_id = 0, amount = 0;
-	while(input_file >> action_type)
+	if (!trace_prefix.empty() && (!batch_path.empty() || !sweep_range.empty()))
 	{
-		type = stringToActionType(action_type);
-		input_file >> task_id;
-		input_file >> delay;
-		input_file >> resource_id;
-		input_file >> amount;
-		task_id--;
-
-		Action action(type, task_id, delay, resource_id - 1, amount);
-		action_container[task_id].push_back(action);
+		cerr << "--trace only applies to a single run, not --batch or --sweep\n";
+		return 1;
 	}
-	banker_action_container = action_container;
-	input_file.close();
 
-	// Bind action pointers
-	for (int i = 0; i < num_tasks; i++)
+	if (!batch_path.empty())
 	{
-		task_list[i].bindActionPointer(action_container[i][0]);
+		if (stream_window > 0)
+		{
+			cerr << "--stream can't be used with --batch\n";
+			return 1;
+		}
+		return runBatchMode(batch_path, jobs, event_driven);
 	}
-	banker_task_list = task_list;
 
-	// Main loop for OptimisticResourceManager
-	OptimisticResourceManager optimistic_manager =
-			OptimisticResourceManager(num_resources, num_tasks, resources_available);
-
-	int current_cycle = 0;
-	bool * blocked_processes = new bool[num_tasks];
-
-	while (!areAllTasksFinished(task_list))
+	bool sweeping = !sweep_range.empty();
+	if (sweeping)
 	{
-		current_cycle = optimistic_manager.getCycle();
-#ifdef DEBUG
-		cout << "Cycle " << current_cycle << " - " << current_cycle + 1 << "\n";
-#endif
-		// Process each task's action for this cycle. Start with blocked processes (sort by when it was blocked in queue = FIFO)
-		stable_sort(task_list.begin(), task_list.end(), compareTasksForSort);
-
-		// For each task, if it's already terminated or aborted, go to the next one
-		// Otherwise, dispatch the action and handle the blocked processes (by updating time blocked)
-		// If a task was successfully dispatched and the delay time has elapsed (or was 0),
-		// Clear that action out of the action container and get a new action pointer for that task (next action)
-		for (int i = 0; i < num_tasks; i++)
+		string sweep_error;
+		if (!parseSweepRange(sweep_range, sweep_options, sweep_error))
 		{
-			Task* current_task = &task_list[i];
-			int task_id = current_task->getId();
-
-			if (current_task->isDoneOrAborted())
-				continue;
-
-			optimistic_manager.dispatchAction(*current_task);
-			if (current_task->isBlocked())
-			{
-				current_task->incrementTimeBlocked();
-			}
-			else if(current_task->getDelay() == 0)
-			{
-				action_container[task_id].erase(action_container[task_id].begin());
-				current_task->bindActionPointer(action_container[task_id][0]);
-			}
+			cerr << sweep_error << "\n";
+			return 1;
 		}
-
-		// Loop in this cycle while no request can be satisfied
-		// HandleDeadlock terminates a process if it finds deadlock.
-		while (optimistic_manager.handleDeadlock(task_list)
-				&& !areAllTasksFinished(task_list))
+		if (stream_window > 0)
 		{
-			if (optimistic_manager.canSatisfyAnyRequest(task_list))
-				break;
+			cerr << "--stream can't be used with --sweep\n";
+			return 1;
 		}
-		optimistic_manager.commitReleasedResources();
-		optimistic_manager.incrementCycle();
+		sweep_options.jobs = jobs > 0 ? jobs : 1;
 	}
-	stable_sort(task_list.begin(), task_list.end(), compareTasksForSort);
-	cout << "\n\tFIFO\n";
-	printTaskStats(task_list);
-
-	// Main loop for OptimisticResourceManager
-	BankerResourceManager banker_manager =
-			BankerResourceManager(num_resources, num_tasks, resources_available);
-	action_container = banker_action_container;
-	task_list = banker_task_list;
 
-	// Bind action pointers
-	for (int i = 0; i < num_tasks; i++)
+	// Read in the file, get number of tasks and number of resources (and amount of each), then the actions.
+	// Binary traces are mapped and their records used in place; text input is parsed and grouped by task.
+	// Either way the actions end up in one ActionTable, which both resource managers read from
+	// In streaming mode the binary trace is read a window of actions per task at a time instead
+	chrono::steady_clock::time_point load_start = chrono::steady_clock::now();
+	TraceInput input;
+	ParseError error;
+	BinaryTrace binary_trace;
+	BinaryTraceReader trace_reader;
+	ActionTable action_table;
+	bool streaming = stream_window > 0;
+	if (streaming)
 	{
-		task_list[i].bindActionPointer(action_container[i][0]);
+		if (!isBinaryTraceFile(filename))
+		{
+			cerr << "--stream needs a binary trace. Convert " << filename << " first with: "
+					<< argv[0] << " convert " << filename << " <binary-trace>\n";
+			return 1;
+		}
+		if (!trace_reader.open(filename, stream_window, error))
+		{
+			printLoadError(filename, error);
+			return 1;
+		}
+		input.num_tasks = trace_reader.getNumTasks();
+		input.num_resources = trace_reader.getNumResources();
+		input.resources.assign(trace_reader.getResources(), trace_reader.getResources() + input.num_resources);
 	}
-
-	while (!areAllTasksFinished(task_list))
+	else if (isBinaryTraceFile(filename))
 	{
-		current_cycle = banker_manager.getCycle();
-#ifdef DEBUG
-		cout << "Cycle " << current_cycle << " - " << current_cycle + 1 << "\n";
-#endif
-		// Process each task's action for this cycle. Start with blocked processes
-		//stable_sort(task_list.begin(), task_list.end(), compareTasksForSort);
-
-		// Process each task's action for this cycle. Start with blocked processes (sort by when it was blocked in queue = FIFO)
-		stable_sort(task_list.begin(), task_list.end(), compareTasksForSort);
-		for (int i = 0; i < num_tasks; i++)
+		if (!binary_trace.open(filename, error))
 		{
-			Task* current_task = &task_list[i];
-			int task_id = current_task->getId();
-
-			if (current_task->isDoneOrAborted())
-				continue;
-
-			banker_manager.dispatchAction(*current_task);
-			if (current_task->isBlocked())
-			{
-				current_task->incrementTimeBlocked();
-			}
-			else if(current_task->getDelay() == 0)
-			{
-				action_container[task_id].erase(action_container[task_id].begin());
-				current_task->bindActionPointer(action_container[task_id][0]);
-			}
+			printLoadError(filename, error);
+			return 1;
 		}
-		banker_manager.commitReleasedResources();
-		banker_manager.incrementCycle();
+		input.num_tasks = binary_trace.getNumTasks();
+		input.num_resources = binary_trace.getNumResources();
+		input.resources.assign(binary_trace.getResources(), binary_trace.getResources() + input.num_resources);
+		action_table = binary_trace.getActionTable();
+	}
+	else
+	{
+		if (!parseTraceFile(filename, input, error))
+		{
+			printLoadError(filename, error);
+			return 1;
+		}
+		action_table = ActionTable(input.num_tasks, input.actions);
+		input.actions.clear();
+		input.actions.shrink_to_fit();
 	}
 
-	stable_sort(task_list.begin(), task_list.end(), compareTasksForSort);
-	cout << "\n\tBanker\n";
-	printTaskStats(task_list);
-
-	// cleanup
-	delete blocked_processes;
-	delete resources_available;
-	return 0;
-}
+	// A sweep re-runs the parsed trace at every capacity point instead
+	if (sweeping)
+	{
+		return runSweep(sweep_options, input.resources, action_table, cout) ? 0 : 1;
+	}
 
-static action_t stringToActionType(const string &str){
-	action_t ret_val;
-	if (str.compare("initiate") == 0)
+	// The two managers share nothing but the read-only input, so they run on separate threads. A streaming
+	// reader keeps per-task windows, so the Banker run gets a reader of its own
+	long long load_ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - load_start).count();
+	RunStats optimistic_stats, banker_stats;
+	Simulation simulation;
+	simulation.setEventDriven(event_driven);
+	if (collect_stats)
 	{
-		ret_val = INITIATE;
+		simulation.setStats(&optimistic_stats, &banker_stats);
 	}
-	else if (str.compare("request") == 0)
+	EventTracer optimistic_tracer, banker_tracer;
+	if (!trace_prefix.empty())
 	{
-		ret_val = REQUEST;
+		if (!optimistic_tracer.open(trace_prefix + ".fifo", TRACE_FIFO)
+				|| !banker_tracer.open(trace_prefix + ".banker", TRACE_BANKER))
+		{
+			cerr << "Unable to write " << trace_prefix << ".fifo and " << trace_prefix << ".banker\n";
+			return 1;
+		}
+		simulation.setTracers(&optimistic_tracer, &banker_tracer);
 	}
-	else if (str.compare("release") == 0)
+	simulation.prepare(input.num_tasks, input.num_resources, input.resources.data());
+	if (streaming)
 	{
-		ret_val = RELEASE;
+		BinaryTraceReader banker_reader;
+		if (!banker_reader.open(filename, stream_window, error))
+		{
+			printLoadError(filename, error);
+			return 1;
+		}
+		simulation.bindStreams(trace_reader, banker_reader);
+		runConcurrently(simulation);
+		if (banker_reader.hasFailed())
+			return 1;
 	}
 	else
 	{
-		ret_val = TERMINATE;
+		simulation.bindStreams(action_table);
+		runConcurrently(simulation);
 	}
-	return ret_val;
+
+	if (!trace_prefix.empty() && !closeTracers(trace_prefix, optimistic_tracer, banker_tracer))
+		return 1;
+	if (collect_stats && !dumpStats(stats_file, optimistic_stats, banker_stats, load_ns))
+		return 1;
+	return trace_reader.hasFailed() ? 1 : 0;
 }
 
-// See if there's any process that's not either done or aborted
-static bool areAllTasksFinished(const taskvec_t &tasklist)
+// Flush the rest of both traces. Returns false if either couldn't be written in full
+static bool closeTracers(const string &trace_prefix, EventTracer &optimistic, EventTracer &banker)
 {
-	bool ret_val = true;
-	for (unsigned int i = 0; i < tasklist.size(); i++)
+	bool optimistic_ok = optimistic.close();
+	bool banker_ok = banker.close();
+	if (!optimistic_ok)
+		cerr << "Unable to write " << trace_prefix << ".fifo\n";
+	if (!banker_ok)
+		cerr << "Unable to write " << trace_prefix << ".banker\n";
+	return optimistic_ok && banker_ok;
+}
+
+// Write the --stats JSON to the given file, or to stderr so it doesn't mix with the simulation output
+static bool dumpStats(const string &stats_file, const RunStats &optimistic, const RunStats &banker, long long load_ns)
+{
+	if (stats_file.empty())
 	{
-		if (!tasklist[i].isDoneOrAborted())
-		{
-			ret_val = false;
-		}
+		writeStatsJson(cerr, optimistic, banker, load_ns);
+		return true;
+	}
+
+	ofstream out(stats_file.c_str());
+	writeStatsJson(out, optimistic, banker, load_ns);
+	if (!out.good())
+	{
+		cerr << "Unable to write " << stats_file << "\n";
+		return false;
 	}
-	return ret_val;
+	return true;
 }
 
-// Print output info based on the info in each task (in tasklist)
-static void printTaskStats(const taskvec_t &tasklist)
+// Run FIFO on this thread and Banker on another. Each writes into its own buffer, and the buffers are
+// printed FIFO first, so the output is the same as running them one after the other
+static void runConcurrently(Simulation &simulation)
 {
-	int total_cycles = 0;
-	int total_blocked_percent = 0;
-	int total_blocked_cycles = 0;
-
-	for (unsigned int i = 0; i < tasklist.size(); i++)
+	ostringstream fifo_output, banker_output;
+	thread banker_thread([&]()
 	{
-		if (tasklist[i].isAborted())
-		{
-			cout << "Task # " << i + 1 << "\taborted\n";
-			continue;
-		}
-		int task_cycles = tasklist[i].getTimeTerminated();
-		int blocked_cycles = tasklist[i].getTimeBlocked();
-		int blocked_percent = floor((float)blocked_cycles/(float)task_cycles*100.f + 0.5f);
+		simulation.runBanker(banker_output);
+	});
+	simulation.runOptimistic(fifo_output);
+	banker_thread.join();
 
-		cout << "Task # " << i + 1
-				<< "\t" << task_cycles << "\t"
-				<< blocked_cycles << "\t" << blocked_percent << "%\n";
+	cout << fifo_output.str() << banker_output.str();
+}
 
-		total_blocked_cycles += blocked_cycles;
-		total_cycles += task_cycles;
+// Simulate every input listed by a directory or manifest; exits non-zero if any couldn't be read
+static int runBatchMode(const string &path, int jobs, bool event_driven)
+{
+	vector<string> inputs;
+	string error;
+	if (!listBatchInputs(path, inputs, error))
+	{
+		cerr << error << "\n";
+		return 1;
 	}
-	total_blocked_percent = floor((float)total_blocked_cycles/(float)total_cycles*100.f + 0.5f);
-	cout << "Total \t\t" << total_cycles << "\t" << total_blocked_cycles << "\t" << total_blocked_percent << "%\n\n";
+	return runBatch(inputs, jobs > 0 ? jobs : 1, event_driven, cout) > 0 ? 1 : 0;
 }
 
-// If a task is blocked, it should come first. These blocked processes should be sorted
-// by the time they were blocked (FIFO). This is used in the OptimisticResourceManager loop
-static bool compareTasksForSort(const Task &a, const Task &b)
+static void printLoadError(const string &filename, const ParseError &error)
 {
-	if (a.isBlocked() && !b.isBlocked() )
+	if (error.line > 0)
 	{
-		return true;
+		cerr << filename << ":" << error.line << ":" << error.column << ": " << error.message << "\n";
 	}
-	if (!a.isBlocked() && b.isBlocked())
+	else
 	{
-		return false;
+		cerr << "Unable to open " << filename << " for input (" << error.message << "). Terminating!\n";
+	}
+}
+
+// Parse a text input file and write it back out as a binary trace
+static int convertTrace(const string &input_filename, const string &output_filename)
+{
+	TraceInput input;
+	ParseError error;
+	if (!parseTraceFile(input_filename, input, error))
+	{
+		printLoadError(input_filename, error);
+		return 1;
 	}
-	if (a.isBlocked() && b.isBlocked())
+	if (!writeBinaryTrace(output_filename, input, error))
 	{
-		if (a.getBlockedSince() == b.getBlockedSince())
+		cerr << error.message << "\n";
+		return 1;
+	}
+	return 0;
+}
+
+// serve <socket-path> [--banker] [--tasks=N] <units>...: one number of units per resource type
+static int runServeMode(int argc, char** argv)
+{
+	ServerOptions options;
+	options.banker = false;
+	options.num_tasks = 0;
+	for (int i = 2; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (arg == "--banker")
+		{
+			options.banker = true;
+		}
+		else if (arg.compare(0, 8, "--tasks=") == 0)
+		{
+			options.num_tasks = atoi(arg.c_str() + 8);
+			if (options.num_tasks <= 0 || options.num_tasks > MAX_SERVE_TASKS)
+			{
+				cerr << "--tasks must be a number of tasks from 1 to " << MAX_SERVE_TASKS << "\n";
+				return 1;
+			}
+		}
+		else if (options.socket_path.empty())
 		{
-			return a.getId() < b.getId();
+			options.socket_path = arg;
+		}
+		else
+		{
+			int units = atoi(arg.c_str());
+			if (units <= 0)
+			{
+				cerr << "Units of each resource type must be positive, not \"" << arg << "\"\n";
+				return 1;
+			}
+			options.units.push_back(units);
 		}
-		return a.getBlockedSince() < b.getBlockedSince();
 	}
-	return a.getId() < b.getId();
+	if (options.socket_path.empty() || options.units.empty())
+	{
+		cerr << "Usage: " << argv[0] << " serve <socket-path> [--banker] [--tasks=N] <units>...\n";
+		return 1;
+	}
+	if (options.num_tasks == 0)
+		options.num_tasks = DEFAULT_SERVE_TASKS;
+	return runServer(options) ? 0 : 1;
 }
-
@@ -1,42 +1,95 @@
 #include "data_types.h"
+#include "run_stats.h"
+#include <algorithm>
 #include <assert.h>
+#include <iostream>
+#include <limits.h>
 
-// Constructor and Destructor for ResourceManager
+// Constructor for ResourceManager
 
-ResourceManager::ResourceManager(int n_resources, int tasks, int* resources_initial)
+ResourceManager::ResourceManager(int n_resources, int tasks, int* resources_initial) :
+	total_resources(resources_initial, resources_initial + n_resources),
+	resources_available(resources_initial, resources_initial + n_resources),
+	cycle_resources_changed(n_resources, 0),
+	units_returned(n_resources, 0),
+	allocations(tasks, n_resources),
+	blocked_queue(tasks), live_tasks(tasks), woken_tasks(tasks), runnable_tasks(tasks),
+	wait_queues(tasks, n_resources), blocked_charged(tasks, 0),
+	waiting_resource(tasks, 0),
+	waiting_amount(tasks, INT_MAX)
 {
 	num_tasks = tasks;
 	num_resources = n_resources;
 	cycle = 0;
-	total_resources = new int[n_resources];
-	resources_available = new int[n_resources];
-	resources_claimed = new int[n_resources];
-	cycle_resources_changed = new int[n_resources];
-
-	for (int i = 0; i < n_resources; i++)
+	dispatch_count = 0;
+	event_driven = false;
+	resources_released = false;
+	releases_pending = false;
+	output = &std::cout;
+	stats = nullptr;
+	tracer = nullptr;
+	resetTaskCounters();
+	resetWaitQueues();
+	for (int i = 0; i < tasks; i++)
 	{
-		total_resources[i] = resources_initial[i];
-		resources_available[i] = resources_initial[i];
-		resources_claimed[i] = 0;
-		cycle_resources_changed[i] = 0;
+		live_tasks.pushBack(i);
 	}
 }
 
-ResourceManager::~ResourceManager()
+// Like reset(), but for a new input with its own number of tasks and resources. Buffers are resized in place,
+// so a manager reused across many inputs only allocates when an input is bigger than any before it.
+// Event-driven mode, the output stream, the stats and the tracer are kept
+void ResourceManager::reinitialize(int n_resources, int tasks, int* resources_initial)
 {
-	delete total_resources;
-	delete resources_available;
-	delete resources_claimed;
-	delete cycle_resources_changed;
+	num_tasks = tasks;
+	num_resources = n_resources;
+	cycle = 0;
+	dispatch_count = 0;
+	resources_released = false;
+	releases_pending = false;
+	wakeups = WakeupQueue_t();
+	total_resources.assign(resources_initial, resources_initial + n_resources);
+	resources_available.assign(resources_initial, resources_initial + n_resources);
+	cycle_resources_changed.assign(n_resources, 0);
+	units_returned.assign(n_resources, 0);
+	waiting_resource.assign(tasks, 0);
+	waiting_amount.assign(tasks, INT_MAX);
+	allocations.resize(tasks, n_resources);
+	blocked_queue.resize(tasks);
+	woken_tasks.resize(tasks);
+	live_tasks.resize(tasks);
+	resetTaskCounters();
+	resetWaitQueues();
+	for (int i = 0; i < tasks; i++)
+	{
+		live_tasks.pushBack(i);
+	}
 }
 
 void ResourceManager::reset()
 {
+	cycle = 0;
+	dispatch_count = 0;
+	resources_released = false;
+	releases_pending = false;
+	wakeups = WakeupQueue_t();
 	for (int i = 0; i < num_resources; i++)
 	{
 		resources_available[i] = total_resources[i];
-		resources_claimed[i] = 0;
 		cycle_resources_changed[i] = 0;
+		units_returned[i] = 0;
+	}
+	allocations.reset();
+	std::fill(waiting_resource.begin(), waiting_resource.end(), 0);
+	std::fill(waiting_amount.begin(), waiting_amount.end(), INT_MAX);
+	blocked_queue.clear();
+	woken_tasks.clear();
+	live_tasks.clear();
+	resetTaskCounters();
+	resetWaitQueues();
+	for (int i = 0; i < num_tasks; i++)
+	{
+		live_tasks.pushBack(i);
 	}
 }
 
@@ -50,6 +103,7 @@ void ResourceManager::incrementResourcesAvailable(int i, int amount)
 {
 	assert (sanityCheck(i));
 	cycle_resources_changed[i] += amount;
+	releases_pending = true;
 }
 
 void ResourceManager::decrementResourcesAvailable(int i, int amount)
@@ -61,24 +115,275 @@ void ResourceManager::decrementResourcesAvailable(int i, int amount)
 // At the end of each cycle, commit any increases/decreases made to resource availability
 void ResourceManager::commitReleasedResources()
 {
+	resources_released = false;
+	releases_pending = false;
+	changed_resources.clear();
 	for (int i = 0; i < num_resources; i++)
 	{
+		if (cycle_resources_changed[i] != 0)
+		{
+			resources_released = true;
+			changed_resources.push_back(i);
+		}
 		resources_available[i] += cycle_resources_changed[i];
+		units_returned[i] += cycle_resources_changed[i];
 		cycle_resources_changed[i] = 0;
 	}
 }
 
+// Only ever goes up, so a manager can tell how many units of a resource came back since it last looked
+long long ResourceManager::getUnitsReturned(int i)
+{
+	assert (sanityCheck(i));
+	return units_returned[i];
+}
+
+// In event-driven mode, a task's whole compute delay is charged the first time its action is dispatched,
+// and a wakeup is scheduled for the cycle the action can actually run, so idle cycles can be skipped
+void ResourceManager::setEventDriven(bool enabled)
+{
+	event_driven = enabled;
+}
+
+bool ResourceManager::isEventDriven()
+{
+	return event_driven;
+}
+
+// Every task starts out runnable and waiting on nothing
+void ResourceManager::resetWaitQueues()
+{
+	wait_queues.resize(num_tasks, num_resources);
+	runnable_tasks.resize(num_tasks);
+	for (int i = 0; i < num_tasks; i++)
+	{
+		runnable_tasks.pushBack(i);
+	}
+	blocked_charged.assign(num_tasks, 0);
+	changed_resources.clear();
+}
+
+// Every task starts out runnable. Called whenever the task list is about to be recreated
+void ResourceManager::resetTaskCounters()
+{
+	task_counters.runnable = num_tasks;
+	task_counters.blocked = 0;
+	task_counters.finished = 0;
+	task_counters.aborted = 0;
+}
+
+TaskCounters& ResourceManager::getTaskCounters()
+{
+	return task_counters;
+}
+
+// True once every task has terminated or been aborted. O(1), from the task counters
+bool ResourceManager::allTasksFinished()
+{
+	return task_counters.finished == num_tasks;
+}
+
+// Send the manager's messages somewhere other than std::cout, e.g. a buffer when runs happen concurrently
+void ResourceManager::setOutput(std::ostream &out)
+{
+	output = &out;
+}
+
+std::ostream& ResourceManager::getOutput()
+{
+	return *output;
+}
+
+// Advance the compute delay of the task's current action. Returns true while the task is still computing
+bool ResourceManager::isComputing(const Action &action, Task &task)
+{
+	if (task.getDelay() >= action.getDelay())
+	{
+		return false;
+	}
+	if (event_driven)
+	{
+		int wake_cycle = cycle + action.getDelay() - task.getDelay();
+		task.setDelay(action.getDelay());
+		task.setWakeCycle(wake_cycle);
+		wakeups.push(wakeup_t(wake_cycle, task.getId()));
+	}
+	else
+	{
+		task.incrementDelay();
+	}
+	return true;
+}
+
+// True if the last commit made any resources available. If not, blocked tasks can't make progress
+bool ResourceManager::releasedLastCycle()
+{
+	return resources_released;
+}
+
+// True if units were released since the last commit, so what's available is less than it will be
+bool ResourceManager::hasPendingReleases()
+{
+	return releases_pending;
+}
+
+// Earliest cycle at which a computing task wakes up, or -1 if no task is computing
+int ResourceManager::nextWakeupCycle()
+{
+	while (!wakeups.empty() && wakeups.top().first <= cycle)
+	{
+		wakeups.pop();
+	}
+	return wakeups.empty() ? -1 : wakeups.top().first;
+}
+
+// True if some live task that isn't blocked has an action due this cycle. O(1): a computing task can't block or
+// be aborted, and each one has exactly one wakeup queued, so once the wakeups due by now are dropped, the rest
+// are the runnable tasks that are still computing
+bool ResourceManager::hasTaskDue()
+{
+	nextWakeupCycle();
+	return task_counters.runnable > (int)wakeups.size();
+}
+
+// Put the tasks in woken_ids back in the runnable list, each in its place by id
+void ResourceManager::requeueWoken()
+{
+	if (stats && woken_ids.size() > 1)
+	{
+		stats->sorts++;
+	}
+	std::sort(woken_ids.begin(), woken_ids.end());
+	int position = runnable_tasks.front();
+	for (unsigned int i = 0; i < woken_ids.size(); i++)
+	{
+		while (position >= 0 && position < woken_ids[i])
+		{
+			position = runnable_tasks.nextOf(position);
+		}
+		runnable_tasks.insertBefore(woken_ids[i], position);
+	}
+}
+
+// Add the cycles a waiting task has stayed blocked since it was last charged, up to and including through_cycle
+void ResourceManager::chargeBlockedCycles(Task &task, int through_cycle)
+{
+	int id = task.getId();
+	if (through_cycle > blocked_charged[id])
+	{
+		task.addTimeBlocked(through_cycle - blocked_charged[id]);
+		blocked_charged[id] = through_cycle;
+	}
+}
+
+// Drop a terminated or aborted task from the dispatch lists
+void ResourceManager::retireTask(Task &task)
+{
+	assert (task.isDoneOrAborted());
+	if (wait_queues.contains(task.getId()))
+	{
+		chargeBlockedCycles(task, cycle);
+		wait_queues.remove(task.getId());
+	}
+	runnable_tasks.remove(task.getId());
+	blocked_queue.remove(task.getId());
+	live_tasks.remove(task.getId());
+	setWaiting(task);
+	task.closeActionStream();
+}
+
+// Leave a task that hasn't taken any action yet out of the live and runnable lists and counts, until startTask.
+// Online, a task that never sends anything mustn't keep the other tasks' deadlock from being seen
+void ResourceManager::deferTask(int id)
+{
+	assert (live_tasks.contains(id));
+	live_tasks.remove(id);
+	runnable_tasks.remove(id);
+	task_counters.runnable--;
+}
+
+void ResourceManager::startTask(int id)
+{
+	assert (!live_tasks.contains(id));
+	insertInOrder(live_tasks, id);
+	insertInOrder(runnable_tasks, id);
+	task_counters.runnable++;
+}
+
+// Tasks usually start in id order, so the back of the queue is tried before walking it
+void ResourceManager::insertInOrder(TaskQueue &queue, int id)
+{
+	int position = queue.front();
+	if (queue.back() < id)
+	{
+		position = -1;
+	}
+	while (position >= 0 && position < id)
+	{
+		position = queue.nextOf(position);
+	}
+	queue.insertBefore(id, position);
+}
+
+// Keep the blocked request of each task in flat arrays, so checks over every waiting request can be vectorized
+void ResourceManager::setWaiting(const Task &task)
+{
+	int id = task.getId();
+	if (task.isBlocked() && !task.isDoneOrAborted())
+	{
+		waiting_resource[id] = task.getActionPointer()->getResourceId();
+		waiting_amount[id] = task.getActionPointer()->getAmount();
+	}
+	else
+	{
+		waiting_resource[id] = 0;
+		waiting_amount[id] = INT_MAX;
+	}
+}
+
+const int* ResourceManager::getWaitingResources()
+{
+	return waiting_resource.data();
+}
+
+const int* ResourceManager::getWaitingAmounts()
+{
+	return waiting_amount.data();
+}
+
+const TaskQueue& ResourceManager::getLiveTasks()
+{
+	return live_tasks;
+}
+
+// Tasks driven by this manager are bound to its matrix when they're created
+AllocationMatrix& ResourceManager::getAllocations()
+{
+	return allocations;
+}
+
 void ResourceManager::incrementCycle()
 {
 	cycle++;
 }
 
+int ResourceManager::getTotalResources(int i)
+{
+	assert(sanityCheck(i));
+	return total_resources[i];
+}
+
 int ResourceManager::getResourcesAvailable(int i)
 {
 	assert(sanityCheck(i));
 	return resources_available[i];
 }
 
+const int* ResourceManager::getResourcesAvailableArray()
+{
+	return resources_available.data();
+}
+
 int ResourceManager::getResourcesChanged(int i)
 {
 	assert(sanityCheck(i));
@@ -90,7 +395,39 @@ int ResourceManager::getCycle()
 	return cycle;
 }
 
+long long ResourceManager::getDispatchCount()
+{
+	return dispatch_count;
+}
+
+// Give the manager somewhere to count what it does (--stats), or nullptr to stop counting
+void ResourceManager::setStats(RunStats* run_stats)
+{
+	stats = run_stats;
+}
+
+RunStats* ResourceManager::getStats()
+{
+	return stats;
+}
+
+// Give the manager a tracer to record its events into (--trace), or nullptr to stop tracing
+void ResourceManager::setTracer(EventTracer* event_tracer)
+{
+	tracer = event_tracer;
+}
+
+EventTracer* ResourceManager::getTracer()
+{
+	return tracer;
+}
+
 int ResourceManager::getNumResources()
 {
 	return num_resources;
 }
+
+int ResourceManager::getNumTasks()
+{
+	return num_tasks;
+}
@@ -0,0 +1,63 @@
+#include <iostream>
+#include "run_stats.h"
+
+using namespace std;
+
+static const char* phase_names[NUM_PHASES] = { "dispatch", "deadlock", "commit", "skip" };
+
+RunStats::RunStats()
+{
+	reset();
+}
+
+void RunStats::reset()
+{
+	for (int i = 0; i < NUM_PHASES; i++)
+	{
+		phase_ns[i] = 0;
+	}
+	cycles = dispatches = 0;
+	grants = blocks = aborts = 0;
+	safety_checks = cached_refusals = 0;
+	deadlocks = deadlock_victims = 0;
+	sorts = 0;
+}
+
+PhaseTimer::PhaseTimer(RunStats* run_stats, phase_t timed_phase) : stats(run_stats), phase(timed_phase)
+{
+	if (stats)
+	{
+		start = chrono::steady_clock::now();
+	}
+}
+
+PhaseTimer::~PhaseTimer()
+{
+	if (stats)
+	{
+		stats->phase_ns[phase] += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+	}
+}
+
+static void writeRunStats(ostream &out, const char* name, const RunStats &stats)
+{
+	out << "  \"" << name << "\": {\n    \"phase_ns\": { ";
+	for (int i = 0; i < NUM_PHASES; i++)
+	{
+		out << "\"" << phase_names[i] << "\": " << stats.phase_ns[i] << (i + 1 < NUM_PHASES ? ", " : " },\n");
+	}
+	out << "    \"cycles\": " << stats.cycles << ", \"dispatches\": " << stats.dispatches
+			<< ", \"grants\": " << stats.grants << ", \"blocks\": " << stats.blocks << ", \"aborts\": " << stats.aborts
+			<< ",\n    \"safety_checks\": " << stats.safety_checks << ", \"cached_refusals\": " << stats.cached_refusals
+			<< ", \"deadlocks\": " << stats.deadlocks << ", \"deadlock_victims\": " << stats.deadlock_victims
+			<< ", \"sorts\": " << stats.sorts << "\n  }";
+}
+
+void writeStatsJson(ostream &out, const RunStats &optimistic, const RunStats &banker, long long load_ns)
+{
+	out << "{\n  \"load_ns\": " << load_ns << ",\n";
+	writeRunStats(out, "fifo", optimistic);
+	out << ",\n";
+	writeRunStats(out, "banker", banker);
+	out << "\n}\n";
+}
@@ -0,0 +1,424 @@
+#include <errno.h>
+#include <iostream>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "online_allocator.h"
+#include "server.h"
+
+using namespace std;
+
+// A connection that sends this much without a newline is dropped
+#define MAX_LINE_LENGTH 4096
+
+// Bytes read from a connection at a time
+#define READ_CHUNK 65536
+
+// Once this many bytes of replies are waiting for a client, its messages are left unapplied, and it isn't read
+// from, until it takes some of them
+#define MAX_PENDING_OUTPUT 65536
+
+struct Connection
+{
+	int fd;
+	bool at_eof;		// the client has sent everything it will send
+	string input;		// bytes read and not applied yet: a partial line, or lines held back by MAX_PENDING_OUTPUT
+	string output;		// replies not written yet
+};
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void requestStop(int)
+{
+	stop_requested = 1;
+}
+
+// Skip blanks, then read a word. Returns its length; 0 at the end of the line
+static int nextWord(const char* &text, const char* end, const char* &word)
+{
+	while (text < end && (*text == ' ' || *text == '\t'))
+		text++;
+	word = text;
+	while (text < end && *text != ' ' && *text != '\t')
+		text++;
+	return text - word;
+}
+
+static bool parseNumber(const char* word, int length, int &value)
+{
+	long parsed = 0;
+	bool negative = length > 0 && word[0] == '-';
+	int i = negative ? 1 : 0;
+	if (i == length || length > 11)
+		return false;
+	for (; i < length; i++)
+	{
+		if (word[i] < '0' || word[i] > '9')
+			return false;
+		parsed = parsed * 10 + (word[i] - '0');
+	}
+	parsed = negative ? -parsed : parsed;
+	if (parsed < INT_MIN || parsed > INT_MAX)
+		return false;
+	value = parsed;
+	return true;
+}
+
+static void appendDecision(OnlineAllocator &allocator, decision_t decision, string &out)
+{
+	switch (decision)
+	{
+	case DECISION_OK:
+		out += "ok\n";
+		break;
+	case DECISION_GRANTED:
+		out += "grant\n";
+		break;
+	case DECISION_BLOCKED:
+		out += "block\n";
+		break;
+	case DECISION_ABORTED:
+		out += "abort\n";
+		break;
+	case DECISION_INVALID:
+		out += "error ";
+		out += allocator.getLastError();
+		out += "\n";
+		break;
+	}
+}
+
+static void appendIds(const char* label, const vector<int> &ids, string &out)
+{
+	out += label;
+	for (unsigned int i = 0; i < ids.size(); i++)
+	{
+		out += " ";
+		out += to_string(ids[i] + 1);
+	}
+}
+
+// Apply one message and append its reply. Ids on the wire are 1-based
+static void handleLine(OnlineAllocator &allocator, const char* text, const char* end, string &out)
+{
+	const char* word;
+	int length = nextWord(text, end, word);
+	string keyword(word, length);
+
+	int args[3];
+	int num_args = 0;
+	while ((length = nextWord(text, end, word)) > 0)
+	{
+		if (num_args == 3 || !parseNumber(word, length, args[num_args]))
+		{
+			out += "error bad arguments\n";
+			return;
+		}
+		num_args++;
+	}
+
+	if (keyword == "request" && num_args == 3)
+	{
+		appendDecision(allocator, allocator.request(args[0] - 1, args[1] - 1, args[2]), out);
+	}
+	else if (keyword == "release" && num_args == 3)
+	{
+		appendDecision(allocator, allocator.release(args[0] - 1, args[1] - 1, args[2]), out);
+	}
+	else if (keyword == "initiate" && num_args == 3)
+	{
+		appendDecision(allocator, allocator.initiate(args[0] - 1, args[1] - 1, args[2]), out);
+	}
+	else if (keyword == "terminate" && num_args == 1)
+	{
+		appendDecision(allocator, allocator.terminate(args[0] - 1), out);
+	}
+	else if (keyword == "tick" && num_args == 0)
+	{
+		vector<int> granted, aborted;
+		int cycle = allocator.tick(granted, aborted);
+		out += "tick " + to_string(cycle);
+		appendIds(" granted", granted, out);
+		appendIds(" aborted", aborted, out);
+		out += "\n";
+	}
+	else if (keyword == "reset" && num_args <= 1)
+	{
+		int num_tasks = num_args == 1 ? args[0] : allocator.getNumTasks();
+		if (num_tasks <= 0 || num_tasks > MAX_SERVE_TASKS)
+		{
+			out += "error number of tasks must be from 1 to " + to_string(MAX_SERVE_TASKS) + "\n";
+			return;
+		}
+		allocator.reset(num_tasks);
+		out += "ok\n";
+	}
+	else if (keyword.empty())
+	{
+		out += "error empty message\n";
+	}
+	else
+	{
+		out += "error unknown message or wrong number of arguments\n";
+	}
+}
+
+// Read one chunk of what the client has sent. Returns false if the connection failed
+static bool readMessages(Connection &connection, vector<char> &buffer)
+{
+	while (true)
+	{
+		ssize_t count = read(connection.fd, buffer.data(), buffer.size());
+		if (count == 0)
+		{
+			connection.at_eof = true;
+			return true;
+		}
+		if (count < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		}
+		connection.input.append(buffer.data(), count);
+		return true;
+	}
+}
+
+static bool hasWholeLine(const Connection &connection)
+{
+	return connection.input.find('\n') != string::npos;
+}
+
+// Apply each whole line read, until the replies waiting for the client reach MAX_PENDING_OUTPUT. Returns false
+// once the connection should close
+static bool applyMessages(Connection &connection, OnlineAllocator &allocator)
+{
+	size_t start = 0;
+	size_t newline;
+	while (connection.output.size() < MAX_PENDING_OUTPUT
+			&& (newline = connection.input.find('\n', start)) != string::npos)
+	{
+		size_t end = newline;
+		if (end > start && connection.input[end - 1] == '\r')
+			end--;
+		const char* line = connection.input.data();
+		handleLine(allocator, line + start, line + end, connection.output);
+		start = newline + 1;
+	}
+	connection.input.erase(0, start);
+	if (connection.input.size() > MAX_LINE_LENGTH && !hasWholeLine(connection))
+	{
+		connection.output += "error message too long\n";
+		connection.input.clear();
+		return false;
+	}
+	return true;
+}
+
+// Write as much of the pending replies as the socket takes. Returns false if the connection is gone
+static bool writeReplies(Connection &connection)
+{
+	size_t written = 0;
+	while (written < connection.output.size())
+	{
+		ssize_t count = send(connection.fd, connection.output.data() + written, connection.output.size() - written,
+				MSG_NOSIGNAL);
+		if (count < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+			return false;
+		}
+		written += count;
+	}
+	connection.output.erase(0, written);
+	return true;
+}
+
+// Apply messages and write replies until the client stops taking them or nothing is left to apply. Messages
+// held back by MAX_PENDING_OUTPUT are applied here as soon as the replies ahead of them are written, since no
+// poll event would bring the loop back to them. Returns false once the connection should close
+static bool serveConnection(Connection &connection, OnlineAllocator &allocator)
+{
+	while (true)
+	{
+		bool open = applyMessages(connection, allocator);
+		if (!connection.output.empty() && !writeReplies(connection))
+			return false;
+		if (!open)
+			return false;
+		if (!connection.output.empty())
+			return true;
+		if (!hasWholeLine(connection))
+			return !connection.at_eof;
+	}
+}
+
+// Bind the socket. A socket file left behind by a server that is gone is replaced, a live one is not
+static int openSocket(const string &path)
+{
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (path.empty() || path.size() >= sizeof(address.sun_path))
+	{
+		cerr << "Socket path must be 1 to " << sizeof(address.sun_path) - 1 << " characters\n";
+		return -1;
+	}
+	memcpy(address.sun_path, path.c_str(), path.size());
+
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+	{
+		perror("socket");
+		return -1;
+	}
+	int bound = bind(fd, (struct sockaddr*)&address, sizeof(address));
+	if (bound != 0 && errno == EADDRINUSE)
+	{
+		int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		bool live = probe >= 0 && connect(probe, (struct sockaddr*)&address, sizeof(address)) == 0;
+		if (probe >= 0)
+			close(probe);
+		if (live)
+		{
+			cerr << "Another server is already listening on " << path << "\n";
+			close(fd);
+			return -1;
+		}
+		unlink(path.c_str());
+		bound = bind(fd, (struct sockaddr*)&address, sizeof(address));
+	}
+	if (bound != 0 || listen(fd, SOMAXCONN) != 0)
+	{
+		perror(path.c_str());
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static void acceptConnections(int listen_fd, vector<Connection> &connections)
+{
+	int fd;
+	while ((fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+	{
+		Connection connection;
+		connection.fd = fd;
+		connection.at_eof = false;
+		connections.push_back(connection);
+	}
+}
+
+// A client is only read from while there is room for its replies and every line read so far has been applied
+static bool wantsInput(const Connection &connection)
+{
+	return !connection.at_eof && connection.output.size() < MAX_PENDING_OUTPUT && !hasWholeLine(connection);
+}
+
+static struct pollfd connectionPoll(const Connection &connection)
+{
+	struct pollfd connection_poll = { connection.fd, 0, 0 };
+	if (wantsInput(connection))
+		connection_poll.events |= POLLIN;
+	if (!connection.output.empty())
+		connection_poll.events |= POLLOUT;
+	return connection_poll;
+}
+
+// SIGINT and SIGTERM are only delivered while waiting in ppoll, so a stop request is never missed between
+// checking the flag and going back to sleep
+bool runServer(const ServerOptions &options)
+{
+	int listen_fd = openSocket(options.socket_path);
+	if (listen_fd < 0)
+		return false;
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = requestStop;
+	sigaction(SIGINT, &action, nullptr);
+	sigaction(SIGTERM, &action, nullptr);
+	sigset_t blocked, wait_mask;
+	sigemptyset(&blocked);
+	sigaddset(&blocked, SIGINT);
+	sigaddset(&blocked, SIGTERM);
+	sigprocmask(SIG_BLOCK, &blocked, &wait_mask);
+	sigdelset(&wait_mask, SIGINT);
+	sigdelset(&wait_mask, SIGTERM);
+
+	OnlineAllocator allocator(options.banker, options.num_tasks, options.units);
+	cerr << "Serving " << (options.banker ? "Banker" : "FIFO") << " decisions for " << options.num_tasks
+			<< " tasks and " << options.units.size() << " resources on " << options.socket_path << "\n";
+
+	vector<Connection> connections;
+	vector<struct pollfd> fds;
+	vector<char> buffer(READ_CHUNK);
+	while (!stop_requested)
+	{
+		fds.clear();
+		struct pollfd listen_poll = { listen_fd, POLLIN, 0 };
+		fds.push_back(listen_poll);
+		for (unsigned int i = 0; i < connections.size(); i++)
+		{
+			fds.push_back(connectionPoll(connections[i]));
+		}
+
+		if (ppoll(fds.data(), fds.size(), nullptr, &wait_mask) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			perror("poll");
+			break;
+		}
+
+		// Replies go out as soon as the messages that asked for them have been applied
+		for (unsigned int i = 0; i < connections.size(); i++)
+		{
+			Connection &connection = connections[i];
+			short events = fds[i + 1].revents;
+			bool open = true;
+			if ((events & (POLLIN | POLLHUP | POLLERR)) && wantsInput(connection))
+				open = readMessages(connection, buffer);
+			if (open && events != 0)
+				open = serveConnection(connection, allocator);
+			if (!open)
+			{
+				close(connection.fd);
+				connection.fd = -1;
+			}
+		}
+		for (unsigned int i = 0; i < connections.size(); )
+		{
+			if (connections[i].fd < 0)
+			{
+				connections[i] = connections.back();
+				connections.pop_back();
+			}
+			else
+			{
+				i++;
+			}
+		}
+		if (fds[0].revents & POLLIN)
+			acceptConnections(listen_fd, connections);
+	}
+
+	for (unsigned int i = 0; i < connections.size(); i++)
+	{
+		close(connections[i].fd);
+	}
+	close(listen_fd);
+	unlink(options.socket_path.c_str());
+	sigprocmask(SIG_UNBLOCK, &blocked, nullptr);
+	return true;
+}
@@ -0,0 +1,181 @@
+#include "sharded_manager.h"
+
+using namespace std;
+
+// Shards are allocated one by one, so threads working in different shards don't share cache lines
+ShardedResourceManager::ShardedResourceManager(int num_tasks, const vector<int> &units, int shards_wanted) :
+	ParkingManager<ShardedResourceManager>(num_tasks, units), live(0)
+{
+	num_shards = max(1, min(shards_wanted, num_resources));
+	WaitList empty = { -1, -1 };
+	for (int s = 0; s < num_shards; s++)
+	{
+		unique_ptr<Shard> shard(new Shard());
+		for (int r = s; r < num_resources; r += num_shards)
+		{
+			shard->available.push_back(units[r]);
+		}
+		shard->waiting.assign(shard->available.size(), empty);
+		shard->parked = 0;
+		shard->version = 0;
+		shards.push_back(move(shard));
+	}
+	versions.resize(num_shards);
+}
+
+ShardedResourceManager::Shard &ShardedResourceManager::shardOf(int resource_id)
+{
+	return *shards[resource_id % num_shards];
+}
+
+decision_t ShardedResourceManager::request(int task_id, int resource_id, int amount)
+{
+	return decide(task_id, resource_id, amount, true);
+}
+
+decision_t ShardedResourceManager::tryRequest(int task_id, int resource_id, int amount)
+{
+	return decide(task_id, resource_id, amount, false);
+}
+
+// Grant the request if the units are there, otherwise park (or, for tryRequest, say it would block). Waiters are
+// served as soon as units come back, so any still waiting don't fit in what's available; granting a request that
+// does fit is what the Optimistic manager does after retrying its blocked tasks. Only the resource's shard is locked
+decision_t ShardedResourceManager::decide(int task_id, int resource_id, int amount, bool wait)
+{
+	if (!validAction(task_id, resource_id) || amount < 0)
+		return DECISION_INVALID;
+	unique_lock<mutex> guard(shardOf(resource_id).lock);
+	if (takeUnits(resource_id, amount))
+	{
+		guard.unlock();
+		grant(task_id, resource_id, amount);
+		return DECISION_GRANTED;
+	}
+	if (!wait)
+	{
+		tasks[task_id]->blocks++;
+		return DECISION_BLOCKED;
+	}
+	return park(guard, task_id, resource_id, amount);
+}
+
+mutex &ShardedResourceManager::lockOf(int resource_id)
+{
+	return shardOf(resource_id).lock;
+}
+
+ShardedResourceManager::WaitList &ShardedResourceManager::waitListOf(int resource_id)
+{
+	return shardOf(resource_id).waiting[resource_id / num_shards];
+}
+
+int ShardedResourceManager::unitsAvailable(int resource_id)
+{
+	return shardOf(resource_id).available[resource_id / num_shards];
+}
+
+bool ShardedResourceManager::takeUnits(int resource_id, int amount)
+{
+	int &available = shardOf(resource_id).available[resource_id / num_shards];
+	if (available < amount)
+		return false;
+	available -= amount;
+	return true;
+}
+
+void ShardedResourceManager::giveBack(int resource_id, int amount)
+{
+	Shard &shard = shardOf(resource_id);
+	int index = resource_id / num_shards;
+	lock_guard<mutex> guard(shard.lock);
+	shard.available[index] += amount;
+	if (shard.waiting[index].head >= 0)
+		wakeWaiters(resource_id);
+}
+
+// The version is odd while the count is being changed. Called with the shard's lock held
+void ShardedResourceManager::changeParked(Shard &shard, int delta)
+{
+	shard.version++;
+	shard.parked += delta;
+	shard.version++;
+}
+
+int ShardedResourceManager::countParkedTasks()
+{
+	int parked = 0;
+	for (int s = 0; s < num_shards; s++)
+	{
+		parked += shards[s]->parked.load();
+	}
+	return parked;
+}
+
+void ShardedResourceManager::countStarted()
+{
+	live++;
+}
+
+// The last change before every task is parked is a park, a terminate or an abort, and each of those checks
+// afterwards, so a deadlock is never missed even though a check gives up as soon as any shard is busy. The
+// unsynchronized counts only decide whether to take the deadlock lock and look properly
+bool ShardedResourceManager::countParked(int resource_id)
+{
+	changeParked(shardOf(resource_id), 1);
+	return countParkedTasks() == live.load();
+}
+
+void ShardedResourceManager::countWoken(int resource_id)
+{
+	changeParked(shardOf(resource_id), -1);
+}
+
+void ShardedResourceManager::countAborted(int resource_id)
+{
+	Shard &shard = shardOf(resource_id);
+	shard.version++;
+	shard.parked--;
+	live--;
+	shard.version++;
+}
+
+bool ShardedResourceManager::countEnded()
+{
+	live--;
+	return countParkedTasks() == live.load();
+}
+
+// Read every shard's version, then the parked counts, then the versions again. If every version was even and
+// none moved, each count held from the first pass to the last, so together they are the counts at one moment,
+// taken without stopping any shard
+bool ShardedResourceManager::allParked()
+{
+	for (int s = 0; s < num_shards; s++)
+	{
+		versions[s] = shards[s]->version.load();
+		if (versions[s] % 2 != 0)
+			return false;
+	}
+	int running = live.load();
+	if (running == 0 || countParkedTasks() != running)
+		return false;
+	for (int s = 0; s < num_shards; s++)
+	{
+		if (shards[s]->version.load() != versions[s])
+			return false;
+	}
+	return true;
+}
+
+int ShardedResourceManager::getNumShards() const
+{
+	return num_shards;
+}
+
+int ShardedResourceManager::getAvailable(int resource_id)
+{
+	Shard &shard = shardOf(resource_id);
+	lock_guard<mutex> guard(shard.lock);
+	return shard.available[resource_id / num_shards];
+}
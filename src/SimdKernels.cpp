@@ -0,0 +1,142 @@
+#include "simd_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_X86 1
+#endif
+
+// Scalar versions. These are also used for the tail elements of the vector versions
+
+static bool allLessEqualScalar(const int* need, const int* available, int n)
+{
+	for (int i = 0; i < n; i++)
+	{
+		if (need[i] > available[i])
+			return false;
+	}
+	return true;
+}
+
+static bool anySatisfiableScalar(const int* amounts, const int* resource_ids, int n, const int* available)
+{
+	for (int i = 0; i < n; i++)
+	{
+		if (amounts[i] <= available[resource_ids[i]])
+			return true;
+	}
+	return false;
+}
+
+#ifdef SIMD_X86
+
+// SSE2: 4 resources per compare. There's no gather, so the available counts for anySatisfiable
+// are loaded one lane at a time
+
+__attribute__((target("sse2")))
+static bool allLessEqualSse2(const int* need, const int* available, int n)
+{
+	int i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(need + i));
+		__m128i b = _mm_loadu_si128((const __m128i*)(available + i));
+		if (_mm_movemask_epi8(_mm_cmpgt_epi32(a, b)) != 0)
+			return false;
+	}
+	return allLessEqualScalar(need + i, available + i, n - i);
+}
+
+__attribute__((target("sse2")))
+static bool anySatisfiableSse2(const int* amounts, const int* resource_ids, int n, const int* available)
+{
+	int i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(amounts + i));
+		__m128i b = _mm_set_epi32(available[resource_ids[i + 3]], available[resource_ids[i + 2]],
+				available[resource_ids[i + 1]], available[resource_ids[i]]);
+		if (_mm_movemask_epi8(_mm_cmpgt_epi32(a, b)) != 0xffff)
+			return true;
+	}
+	return anySatisfiableScalar(amounts + i, resource_ids + i, n - i, available);
+}
+
+// AVX2: 8 resources per compare, 16 per loop iteration for the streaming check, and a hardware gather
+// for the available counts
+
+__attribute__((target("avx2")))
+static bool allLessEqualAvx2(const int* need, const int* available, int n)
+{
+	int i = 0;
+	for (; i + 16 <= n; i += 16)
+	{
+		__m256i a0 = _mm256_loadu_si256((const __m256i*)(need + i));
+		__m256i b0 = _mm256_loadu_si256((const __m256i*)(available + i));
+		__m256i a1 = _mm256_loadu_si256((const __m256i*)(need + i + 8));
+		__m256i b1 = _mm256_loadu_si256((const __m256i*)(available + i + 8));
+		__m256i greater = _mm256_or_si256(_mm256_cmpgt_epi32(a0, b0), _mm256_cmpgt_epi32(a1, b1));
+		if (!_mm256_testz_si256(greater, greater))
+			return false;
+	}
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256i a = _mm256_loadu_si256((const __m256i*)(need + i));
+		__m256i b = _mm256_loadu_si256((const __m256i*)(available + i));
+		__m256i greater = _mm256_cmpgt_epi32(a, b);
+		if (!_mm256_testz_si256(greater, greater))
+			return false;
+	}
+	return allLessEqualScalar(need + i, available + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static bool anySatisfiableAvx2(const int* amounts, const int* resource_ids, int n, const int* available)
+{
+	int i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256i a = _mm256_loadu_si256((const __m256i*)(amounts + i));
+		__m256i ids = _mm256_loadu_si256((const __m256i*)(resource_ids + i));
+		__m256i b = _mm256_i32gather_epi32(available, ids, 4);
+		if (_mm256_movemask_epi8(_mm256_cmpgt_epi32(a, b)) != -1)
+			return true;
+	}
+	return anySatisfiableScalar(amounts + i, resource_ids + i, n - i, available);
+}
+
+#endif /* SIMD_X86 */
+
+static const SimdKernels scalar_kernels = { "scalar", allLessEqualScalar, anySatisfiableScalar };
+#ifdef SIMD_X86
+static const SimdKernels sse2_kernels = { "sse2", allLessEqualSse2, anySatisfiableSse2 };
+static const SimdKernels avx2_kernels = { "avx2", allLessEqualAvx2, anySatisfiableAvx2 };
+#endif
+
+int simdKernelVariants(const SimdKernels** variants, int max_variants)
+{
+	int count = 0;
+	if (count < max_variants)
+		variants[count++] = &scalar_kernels;
+#ifdef SIMD_X86
+	__builtin_cpu_init();
+	if (count < max_variants && __builtin_cpu_supports("sse2"))
+		variants[count++] = &sse2_kernels;
+	if (count < max_variants && __builtin_cpu_supports("avx2"))
+		variants[count++] = &avx2_kernels;
+#endif
+	return count;
+}
+
+static const SimdKernels* pickBestKernels()
+{
+	const SimdKernels* variants[3];
+	int count = simdKernelVariants(variants, 3);
+	return variants[count - 1];
+}
+
+// Picked once. Initializing a function-local static is thread safe
+const SimdKernels& simdKernels()
+{
+	static const SimdKernels* best = pickBestKernels();
+	return *best;
+}
@@ -0,0 +1,271 @@
+#include <iostream>
+#include <math.h>
+#include "event_trace.h"
+#include "run_stats.h"
+#include "simulation.h"
+
+using namespace std;
+
+static SimulationSummary printTaskStats(const taskvec_t &tasklist, ostream &out);
+template <class Manager>
+static void skipIdleCycles(Manager &manager, taskvec_t &task_list);
+static void createTasks(ResourceManager &manager, int num_tasks, taskvec_t &task_list);
+static void finishStats(ResourceManager &manager);
+static bool isPastBound(ResourceManager &manager, const atomic<long long>* rank_bound);
+static SimulationSummary stoppedSummary();
+
+// Both managers start out empty; prepare() sizes them for an input
+Simulation::Simulation() :
+	optimistic_manager(0, 0, nullptr), banker_manager(0, 0, nullptr)
+{
+}
+
+void Simulation::setEventDriven(bool enabled)
+{
+	optimistic_manager.setEventDriven(enabled);
+	banker_manager.setEventDriven(enabled);
+}
+
+// Size both managers and task lists for an input. Buffers are reused from the previous input
+void Simulation::prepare(int num_tasks, int num_resources, int* resources)
+{
+	optimistic_manager.reinitialize(num_resources, num_tasks, resources);
+	banker_manager.reinitialize(num_resources, num_tasks, resources);
+	createTasks(optimistic_manager, num_tasks, optimistic_tasks);
+	createTasks(banker_manager, num_tasks, banker_tasks);
+}
+
+// Count what each manager does into the given stats (--stats). Either may be nullptr
+void Simulation::setStats(RunStats* optimistic_stats, RunStats* banker_stats)
+{
+	optimistic_manager.setStats(optimistic_stats);
+	banker_manager.setStats(banker_stats);
+}
+
+// Record what each manager does into the given tracers (--trace). Either may be nullptr
+void Simulation::setTracers(EventTracer* optimistic_tracer, EventTracer* banker_tracer)
+{
+	optimistic_manager.setTracer(optimistic_tracer);
+	banker_manager.setTracer(banker_tracer);
+}
+
+// Both runs read the same table; it is only ever read
+void Simulation::bindStreams(const ActionTable &action_table)
+{
+	for (int i = 0; i < action_table.getNumTasks(); i++)
+	{
+		optimistic_tasks[i].bindActionStream(action_table.getStream(i));
+		banker_tasks[i].bindActionStream(action_table.getStream(i));
+	}
+}
+
+// A streaming reader keeps one window per task, so each run needs a reader of its own
+void Simulation::bindStreams(BinaryTraceReader &optimistic_reader, BinaryTraceReader &banker_reader)
+{
+	for (int i = 0; i < optimistic_reader.getNumTasks(); i++)
+	{
+		optimistic_tasks[i].bindActionStream(optimistic_reader.getStream(i));
+		banker_tasks[i].bindActionStream(banker_reader.getStream(i));
+	}
+}
+
+// Main loop for OptimisticResourceManager
+SimulationSummary Simulation::runOptimistic(ostream &out, const atomic<long long>* rank_bound)
+{
+	taskvec_t &task_list = optimistic_tasks;
+	optimistic_manager.setOutput(out);
+
+	while (!optimistic_manager.allTasksFinished())
+	{
+		if (isPastBound(optimistic_manager, rank_bound))
+			return stoppedSummary();
+		if (optimistic_manager.getTracer())
+			optimistic_manager.getTracer()->record(optimistic_manager.getCycle(), TRACE_CYCLE, -1, -1, 0, 0);
+		RunStats* stats = optimistic_manager.getStats();
+		{
+			PhaseTimer timer(stats, PHASE_DISPATCH);
+			optimistic_manager.dispatchCycle<0>(task_list);
+		}
+
+		// If every live task is blocked, abort the lowest-id tasks until some request can be satisfied
+		{
+			PhaseTimer timer(stats, PHASE_DEADLOCK);
+			optimistic_manager.resolveDeadlock(task_list);
+		}
+		{
+			PhaseTimer timer(stats, PHASE_COMMIT);
+			optimistic_manager.commitReleasedResources();
+		}
+		optimistic_manager.incrementCycle();
+		{
+			PhaseTimer timer(stats, PHASE_SKIP);
+			skipIdleCycles(optimistic_manager, task_list);
+		}
+	}
+	finishStats(optimistic_manager);
+	out << "\n\tFIFO\n";
+	SimulationSummary summary = printTaskStats(task_list, out);
+	summary.cycles = optimistic_manager.getCycle();
+	summary.dispatches = optimistic_manager.getDispatchCount();
+	return summary;
+}
+
+// Run the Banker loop with the number of resource types fixed at compile time, when there are few enough of them
+SimulationSummary Simulation::runBanker(ostream &out, const atomic<long long>* rank_bound)
+{
+	switch (banker_manager.getNumResources())
+	{
+	case 1:
+		return runBankerWith<1>(out, rank_bound);
+	case 2:
+		return runBankerWith<2>(out, rank_bound);
+	case 3:
+		return runBankerWith<3>(out, rank_bound);
+	case 4:
+		return runBankerWith<4>(out, rank_bound);
+	default:
+		return runBankerWith<0>(out, rank_bound);
+	}
+}
+
+// Main loop for BankerResourceManager. N is the number of resource types, or 0 if it isn't fixed
+template <int N>
+SimulationSummary Simulation::runBankerWith(ostream &out, const atomic<long long>* rank_bound)
+{
+	taskvec_t &task_list = banker_tasks;
+	banker_manager.setOutput(out);
+
+	while (!banker_manager.allTasksFinished())
+	{
+		if (isPastBound(banker_manager, rank_bound))
+			return stoppedSummary();
+		if (banker_manager.getTracer())
+			banker_manager.getTracer()->record(banker_manager.getCycle(), TRACE_CYCLE, -1, -1, 0, 0);
+		RunStats* stats = banker_manager.getStats();
+		{
+			PhaseTimer timer(stats, PHASE_DISPATCH);
+			banker_manager.dispatchCycle<N>(task_list);
+		}
+		{
+			PhaseTimer timer(stats, PHASE_COMMIT);
+			banker_manager.commitReleasedResources();
+		}
+		banker_manager.incrementCycle();
+		{
+			PhaseTimer timer(stats, PHASE_SKIP);
+			skipIdleCycles(banker_manager, task_list);
+		}
+	}
+	finishStats(banker_manager);
+	out << "\n\tBanker\n";
+	SimulationSummary summary = printTaskStats(task_list, out);
+	summary.cycles = banker_manager.getCycle();
+	summary.dispatches = banker_manager.getDispatchCount();
+	return summary;
+}
+
+long long simulationRank(int aborted_tasks, int makespan)
+{
+	return ((long long)aborted_tasks << 32) | (unsigned int)makespan;
+}
+
+// Only called while some task is live. That task terminates this cycle or later, and aborts are never undone,
+// so the finished run ranks at least as high as (aborts so far, current cycle)
+static bool isPastBound(ResourceManager &manager, const atomic<long long>* rank_bound)
+{
+	if (!rank_bound)
+		return false;
+	int aborted = manager.getTaskCounters().aborted;
+	return simulationRank(aborted, manager.getCycle()) > rank_bound->load(memory_order_relaxed);
+}
+
+static SimulationSummary stoppedSummary()
+{
+	SimulationSummary summary = { 0, 0, 0, 0, false, 0, 0 };
+	return summary;
+}
+
+// Tasks are created in id order and bound to the manager's allocation matrix. The task list's storage is
+// kept from the previous input
+static void createTasks(ResourceManager &manager, int num_tasks, taskvec_t &task_list)
+{
+	task_list.clear();
+	task_list.reserve(num_tasks);
+	for (int i = 0; i < num_tasks; i++)
+	{
+		task_list.push_back(Task(manager.getAllocations(), manager.getTaskCounters(), i));
+	}
+}
+
+// Copy the totals the manager keeps anyway into its stats, once the run is over
+static void finishStats(ResourceManager &manager)
+{
+	RunStats* stats = manager.getStats();
+	if (!stats)
+		return;
+
+	stats->cycles = manager.getCycle();
+	stats->dispatches = manager.getDispatchCount();
+	stats->aborts = manager.getTaskCounters().aborted;
+}
+
+// In event-driven mode, jump straight to the next cycle where something can change. That is only safe when
+// no live task has an action due now and nothing was released last cycle (so blocked tasks stay blocked).
+// The manager charges blocked tasks for the skipped cycles
+template <class Manager>
+static void skipIdleCycles(Manager &manager, taskvec_t &task_list)
+{
+	int current_cycle = manager.getCycle();
+	if (!manager.isEventDriven() || manager.releasedLastCycle())
+		return;
+
+	if (manager.hasTaskDue())
+		return;
+
+	int next_cycle = manager.nextWakeupCycle();
+	if (next_cycle <= current_cycle)
+		return;
+
+	if (manager.getTracer())
+		manager.getTracer()->record(current_cycle, TRACE_SKIP, -1, -1, 0, next_cycle);
+	manager.skipToCycle(next_cycle, task_list);
+}
+
+// Print output info based on the info in each task (in tasklist), and return the totals
+static SimulationSummary printTaskStats(const taskvec_t &tasklist, ostream &out)
+{
+	int total_cycles = 0;
+	int total_blocked_percent = 0;
+	int total_blocked_cycles = 0;
+	SimulationSummary summary = { 0, 0, 0, 0, true, 0, 0 };
+
+	for (unsigned int i = 0; i < tasklist.size(); i++)
+	{
+		if (tasklist[i].getTimeTerminated() > summary.makespan)
+		{
+			summary.makespan = tasklist[i].getTimeTerminated();
+		}
+		if (tasklist[i].isAborted())
+		{
+			out << "Task # " << i + 1 << "\taborted\n";
+			summary.aborted_tasks++;
+			continue;
+		}
+		int task_cycles = tasklist[i].getTimeTerminated();
+		int blocked_cycles = tasklist[i].getTimeBlocked();
+		int blocked_percent = floor((float)blocked_cycles/(float)task_cycles*100.f + 0.5f);
+
+		out << "Task # " << i + 1
+				<< "\t" << task_cycles << "\t"
+				<< blocked_cycles << "\t" << blocked_percent << "%\n";
+
+		total_blocked_cycles += blocked_cycles;
+		total_cycles += task_cycles;
+	}
+	total_blocked_percent = floor((float)total_blocked_cycles/(float)total_cycles*100.f + 0.5f);
+	out << "Total \t\t" << total_cycles << "\t" << total_blocked_cycles << "\t" << total_blocked_percent << "%\n\n";
+
+	summary.total_cycles = total_cycles;
+	summary.total_blocked = total_blocked_cycles;
+	return summary;
+}
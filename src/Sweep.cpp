@@ -0,0 +1,191 @@
+#include <climits>
+#include <iostream>
+#include <memory>
+#include <stdlib.h>
+#include "simulation.h"
+#include "sweep.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+// A grid over every resource grows as (number of percentages)^(number of resources)
+#define MAX_SWEEP_POINTS 1000000
+
+// Results for one grid point, for FIFO and Banker
+struct SweepResult
+{
+	SimulationSummary runs[2];
+};
+
+// Each worker keeps its simulation and scaled totals from one point to the next
+struct SweepWorker
+{
+	Simulation simulation;
+	vector<int> resources;
+};
+
+static bool parsePercent(const string &text, int &value)
+{
+	char* end = nullptr;
+	long parsed = strtol(text.c_str(), &end, 10);
+	if (text.empty() || *end != '\0' || parsed < 0 || parsed > INT_MAX / 100)
+		return false;
+	value = parsed;
+	return true;
+}
+
+bool parseSweepRange(const string &spec, SweepOptions &options, string &error)
+{
+	size_t first = spec.find(':');
+	size_t second = first == string::npos ? string::npos : spec.find(':', first + 1);
+	if (second == string::npos
+			|| !parsePercent(spec.substr(0, first), options.low)
+			|| !parsePercent(spec.substr(first + 1, second - first - 1), options.high)
+			|| !parsePercent(spec.substr(second + 1), options.step))
+	{
+		error = "sweep range must be low:high:step, in whole percent";
+		return false;
+	}
+	if (options.step == 0 || options.low > options.high)
+	{
+		error = "sweep range needs low <= high and a step above 0";
+		return false;
+	}
+	return true;
+}
+
+// The percentage each resource gets at a point. In a grid, resource 0 varies slowest
+static void pointPercentages(const SweepOptions &options, int num_percentages, long long point, vector<int> &percent)
+{
+	for (int i = percent.size() - 1; i >= 0; i--)
+	{
+		percent[i] = options.low + options.step * (int)(point % num_percentages);
+		if (options.each_resource)
+		{
+			point /= num_percentages;
+		}
+	}
+}
+
+// Lower best to rank if it's an improvement; other workers may be doing the same
+static void updateBest(atomic<long long> &best, long long rank)
+{
+	long long current = best.load();
+	while (rank < current && !best.compare_exchange_weak(current, rank))
+	{
+	}
+}
+
+static void printCapacity(const vector<int> &percent, bool each_resource, ostream &out)
+{
+	int count = each_resource ? percent.size() : min((int)percent.size(), 1);
+	for (int i = 0; i < count; i++)
+	{
+		out << (i > 0 ? "," : "") << percent[i] << "%";
+	}
+}
+
+static void printRun(const SimulationSummary &run, ostream &out)
+{
+	if (run.completed)
+		out << "\t" << run.makespan << "\t" << run.total_blocked << "\t" << run.aborted_tasks;
+	else
+		out << "\tstopped\t-\t-";
+}
+
+// Better means fewer aborts, then a shorter makespan (the order early exit prunes on), then fewer blocked cycles
+static bool isBetter(const SimulationSummary &a, const SimulationSummary &b)
+{
+	long long rank_a = simulationRank(a.aborted_tasks, a.makespan);
+	long long rank_b = simulationRank(b.aborted_tasks, b.makespan);
+	if (rank_a != rank_b)
+		return rank_a < rank_b;
+	return a.total_blocked < b.total_blocked;
+}
+
+bool runSweep(const SweepOptions &options, const vector<int> &resources, const ActionTable &action_table, ostream &out)
+{
+	int num_resources = resources.size();
+	int num_percentages = (options.high - options.low) / options.step + 1;
+	long long num_points = num_percentages;
+	for (int i = 1; options.each_resource && i < num_resources; i++)
+	{
+		num_points *= num_percentages;
+		if (num_points > MAX_SWEEP_POINTS)
+		{
+			cerr << "Sweep grid has more than " << MAX_SWEEP_POINTS << " points; use a coarser step\n";
+			return false;
+		}
+	}
+
+	vector<SweepResult> results(num_points);
+	atomic<long long> best_rank[2];
+	best_rank[0] = LLONG_MAX;
+	best_rank[1] = LLONG_MAX;
+
+	WorkStealingPool pool(min((long long)options.jobs, num_points));
+	vector<unique_ptr<SweepWorker> > workers;
+	for (int i = 0; i < pool.getNumWorkers(); i++)
+	{
+		workers.push_back(unique_ptr<SweepWorker>(new SweepWorker()));
+	}
+
+	pool.run(num_points, [&](int worker_id, int point)
+	{
+		SweepWorker &worker = *workers[worker_id];
+		vector<int> percent(num_resources);
+		pointPercentages(options, num_percentages, point, percent);
+		worker.resources.resize(num_resources);
+		for (int i = 0; i < num_resources; i++)
+		{
+			worker.resources[i] = ((long long)resources[i] * percent[i] + 50) / 100;
+		}
+
+		// Per-task output isn't wanted, so it goes to a stream with no buffer
+		ostream discard(nullptr);
+		Simulation &simulation = worker.simulation;
+		SweepResult &result = results[point];
+		simulation.prepare(action_table.getNumTasks(), num_resources, worker.resources.data());
+		simulation.bindStreams(action_table);
+		result.runs[0] = simulation.runOptimistic(discard, options.early_exit ? &best_rank[0] : nullptr);
+		result.runs[1] = simulation.runBanker(discard, options.early_exit ? &best_rank[1] : nullptr);
+		for (int i = 0; i < 2; i++)
+		{
+			if (result.runs[i].completed)
+				updateBest(best_rank[i], simulationRank(result.runs[i].aborted_tasks, result.runs[i].makespan));
+		}
+	});
+
+	out << "Sweep: " << num_points << " points, " << options.low << "% to " << options.high << "% in steps of "
+			<< options.step << "%" << (options.each_resource ? ", each resource separately" : "") << "\n";
+	out << "capacity\tFIFO makespan\tblocked\taborted\tBanker makespan\tblocked\taborted\n";
+
+	vector<int> percent(num_resources);
+	long long best[2] = { -1, -1 };
+	for (long long point = 0; point < num_points; point++)
+	{
+		pointPercentages(options, num_percentages, point, percent);
+		printCapacity(percent, options.each_resource, out);
+		for (int i = 0; i < 2; i++)
+		{
+			const SimulationSummary &run = results[point].runs[i];
+			printRun(run, out);
+			if (run.completed && (best[i] < 0 || isBetter(run, results[best[i]].runs[i])))
+				best[i] = point;
+		}
+		out << "\n";
+	}
+
+	const char* names[2] = { "FIFO", "Banker" };
+	for (int i = 0; i < 2; i++)
+	{
+		if (best[i] < 0)
+			continue;
+		pointPercentages(options, num_percentages, best[i], percent);
+		out << "Best " << names[i] << ": ";
+		printCapacity(percent, options.each_resource, out);
+		printRun(results[best[i]].runs[i], out);
+		out << "\n";
+	}
+	return true;
+}
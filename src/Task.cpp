@@ -1,48 +1,38 @@
 #include "data_types.h"
 #include <assert.h>
 
-// Constructor and Destructor for Task
-Task::Task(int n_resources, int i)
+// Constructor for Task. A new task is runnable; the manager's counters already count it as such
+Task::Task(AllocationMatrix &matrix, TaskCounters &task_counters, int i) : end_of_actions(TERMINATE, i, 0, 0, 0)
 {
+	allocations = &matrix;
+	counters = &task_counters;
 	id = i;
 	time_created = -1;
 	time_terminated = -1;
 	blocked = false;
 	aborted = false;
 	time_blocked = 0;
-	// Hello memory leak
-	resources_held = new int[n_resources];
-	resources_claimed = new int[n_resources];
-	num_resources = n_resources;
 	delay = 0;
 	blocked_since = -1;
-	action_ptr = nullptr;
-}
-
-// TODO: fix memory leaks. shared_ptrs or proper C???
-Task::~Task()
-{
-
-//	delete resources_held;
-//	delete resources_claimed;
+	wake_cycle = -1;
 }
 
 // Sanity check for out of bounds array access
 bool Task::sanityCheck(int i) const {
-	return (i >= 0) && (i < num_resources);
+	return (i >= 0) && (i < allocations->getNumResources());
 }
 
 // Set methods
 void Task::setResourceHeld(int i, int amount)
 {
 	assert (sanityCheck(i));
-	resources_held[i] = amount;
+	allocations->setHeld(id, i, amount);
 }
 
 void Task::setResourceClaimed(int i, int amount)
 {
 	assert (sanityCheck(i));
-	resources_claimed[i] = amount;
+	allocations->setClaim(id, i, amount);
 }
 
 void Task::setDelay(int i)
@@ -57,7 +47,9 @@ void Task::incrementDelay()
 
 void Task::setTimeTerminated(int i)
 {
+	bool was_finished = isDoneOrAborted();
 	time_terminated = i;
+	countTransition(blocked, was_finished);
 }
 
 void Task::setTimeCreated(int i)
@@ -70,43 +62,101 @@ void Task::setBlockedSince(int i)
 	blocked_since = i;
 }
 
+// Cycle at which a task computing in event-driven mode next needs to be dispatched
+void Task::setWakeCycle(int i)
+{
+	wake_cycle = i;
+}
+
 void Task::block()
 {
+	bool was_blocked = blocked;
 	blocked = true;
+	countTransition(was_blocked, isDoneOrAborted());
 }
 
 void Task::unblock()
 {
+	bool was_blocked = blocked;
 	blocked_since = -1;
 	blocked = false;
+	countTransition(was_blocked, isDoneOrAborted());
 }
 
 void Task::abort()
 {
+	if (!aborted)
+	{
+		counters->aborted++;
+	}
 	aborted = true;
 }
 
+// Move the task between the runnable, blocked and finished counts after blocked or time_terminated changed
+void Task::countTransition(bool was_blocked, bool was_finished)
+{
+	bool finished = isDoneOrAborted();
+	if (was_blocked == blocked && was_finished == finished)
+		return;
+
+	if (was_finished)
+		counters->finished--;
+	else if (was_blocked)
+		counters->blocked--;
+	else
+		counters->runnable--;
+
+	if (finished)
+		counters->finished++;
+	else if (blocked)
+		counters->blocked++;
+	else
+		counters->runnable++;
+}
+
 void Task::incrementTimeBlocked()
 {
 	time_blocked++;
 }
 
-void Task::bindActionPointer(Action &action)
+// Used when the event-driven clock skips cycles in which the task stayed blocked
+void Task::addTimeBlocked(int cycles)
 {
-	action_ptr = &action;
+	time_blocked += cycles;
+}
+
+void Task::bindActionStream(const ActionStream &stream)
+{
+	actions = stream;
+}
+
+// Called once the task is retired, so a streaming source can free the task's buffered actions
+void Task::closeActionStream()
+{
+	actions.close();
+}
+
+// Move on to the task's next action once the current one has completed. A stream that ran dry has nothing to
+// advance past: the action that completed was end_of_actions
+void Task::advanceAction()
+{
+	if (!actions.exhausted())
+	{
+		actions.advance();
+	}
 }
 
 // Get methods
 int Task::getResourceHeld(int i) const
 {
 	assert (sanityCheck(i));
-	return resources_held[i];
+	return allocations->getHeld(id, i);
 }
 
 int Task::getResourceClaim(int i) const
 {
 	assert (sanityCheck(i));
-	return resources_claimed[i];
+	return allocations->getClaim(id, i);
 }
 
 int Task::getId() const
@@ -153,21 +203,29 @@ int Task::getBlockedSince() const
 	return blocked_since;
 }
 
-Action* Task::getActionPointer() const
+int Task::getWakeCycle() const
+{
+	return wake_cycle;
+}
+
+// Inputs are checked to end every task with terminate, but a stream can still run dry early (a failed read from
+// a binary trace), so a task that runs out of actions terminates instead
+const Action* Task::getActionPointer() const
 {
-	return action_ptr;
+	const Action* action = actions.current();
+	return action ? action : &end_of_actions;
 }
 
 // Additional setting for increment/decrement
 void Task::grantResources(int i, int amount)
 {
 	assert (sanityCheck(i));
-	resources_held[i] += amount;
+	allocations->setHeld(id, i, allocations->getHeld(id, i) + amount);
 	unblock();
 }
 
 void Task::releaseResources(int i, int amount)
 {
 	assert (sanityCheck(i));
-	resources_held[i] -= amount;
+	allocations->setHeld(id, i, allocations->getHeld(id, i) - amount);
 }
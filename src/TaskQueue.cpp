@@ -0,0 +1,147 @@
+#include "data_types.h"
+#include <assert.h>
+
+// TaskQueue is a doubly-linked list threaded through arrays indexed by task id, so a task can be
+// appended, unlinked, or looked up in O(1) without moving any Task objects around
+
+TaskQueue::TaskQueue(int n_tasks)
+{
+	head = -1;
+	tail = -1;
+	count = 0;
+	prev.assign(n_tasks, -1);
+	next.assign(n_tasks, -1);
+	member.assign(n_tasks, false);
+}
+
+// Empty the queue and size it for a different number of tasks, keeping the arrays' storage
+void TaskQueue::resize(int n_tasks)
+{
+	head = -1;
+	tail = -1;
+	count = 0;
+	prev.assign(n_tasks, -1);
+	next.assign(n_tasks, -1);
+	member.assign(n_tasks, false);
+}
+
+// Sanity check for out of bounds array access
+bool TaskQueue::sanityCheck(int id) const
+{
+	return (id >= 0) && (id < (int)member.size());
+}
+
+void TaskQueue::pushBack(int id)
+{
+	assert (sanityCheck(id));
+	assert (!member[id]);
+	prev[id] = tail;
+	next[id] = -1;
+	if (tail >= 0)
+	{
+		next[tail] = id;
+	}
+	else
+	{
+		head = id;
+	}
+	tail = id;
+	member[id] = true;
+	count++;
+}
+
+void TaskQueue::remove(int id)
+{
+	assert (sanityCheck(id));
+	if (!member[id])
+		return;
+
+	if (prev[id] >= 0)
+	{
+		next[prev[id]] = next[id];
+	}
+	else
+	{
+		head = next[id];
+	}
+	if (next[id] >= 0)
+	{
+		prev[next[id]] = prev[id];
+	}
+	else
+	{
+		tail = prev[id];
+	}
+	prev[id] = -1;
+	next[id] = -1;
+	member[id] = false;
+	count--;
+}
+
+// Unlink every member. Costs O(size), not O(number of tasks)
+void TaskQueue::clear()
+{
+	while (head >= 0)
+	{
+		remove(head);
+	}
+}
+
+bool TaskQueue::contains(int id) const
+{
+	assert (sanityCheck(id));
+	return member[id];
+}
+
+bool TaskQueue::empty() const
+{
+	return count == 0;
+}
+
+int TaskQueue::size() const
+{
+	return count;
+}
+
+// Returns -1 if the queue is empty
+int TaskQueue::front() const
+{
+	return head;
+}
+
+int TaskQueue::back() const
+{
+	return tail;
+}
+
+// Link id in just before member before, or at the back if before is -1
+void TaskQueue::insertBefore(int id, int before)
+{
+	if (before < 0)
+	{
+		pushBack(id);
+		return;
+	}
+	assert (sanityCheck(id) && sanityCheck(before));
+	assert (!member[id] && member[before]);
+	prev[id] = prev[before];
+	next[id] = before;
+	if (prev[before] >= 0)
+	{
+		next[prev[before]] = id;
+	}
+	else
+	{
+		head = id;
+	}
+	prev[before] = id;
+	member[id] = true;
+	count++;
+}
+
+// Returns -1 if id is the last task in the queue
+int TaskQueue::nextOf(int id) const
+{
+	assert (sanityCheck(id));
+	return next[id];
+}
@@ -0,0 +1,74 @@
+#include <thread>
+#include "thread_pool.h"
+
+WorkStealingPool::WorkStealingPool(int workers)
+{
+	num_workers = workers > 0 ? workers : 1;
+	for (int i = 0; i < num_workers; i++)
+	{
+		queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+	}
+}
+
+int WorkStealingPool::getNumWorkers() const
+{
+	return num_workers;
+}
+
+// Deal the jobs out, run the workers until every deque is empty, and wait for them
+void WorkStealingPool::run(int num_jobs, const std::function<void(int worker, int job)> &job_fn)
+{
+	for (int i = 0; i < num_jobs; i++)
+	{
+		queues[i % num_workers]->jobs.push_back(i);
+	}
+
+	std::vector<std::thread> threads;
+	for (int i = 1; i < num_workers; i++)
+	{
+		threads.push_back(std::thread(&WorkStealingPool::work, this, i, std::cref(job_fn)));
+	}
+	work(0, job_fn);
+	for (unsigned int i = 0; i < threads.size(); i++)
+	{
+		threads[i].join();
+	}
+}
+
+// Jobs are never added while the pool runs, so a worker whose deque is empty and that finds nothing to steal is done
+void WorkStealingPool::work(int worker, const std::function<void(int worker, int job)> &job_fn)
+{
+	int job;
+	while (takeLocal(worker, job) || steal(worker, job))
+	{
+		job_fn(worker, job);
+	}
+}
+
+bool WorkStealingPool::takeLocal(int worker, int &job)
+{
+	WorkerQueue &queue = *queues[worker];
+	std::lock_guard<std::mutex> guard(queue.lock);
+	if (queue.jobs.empty())
+		return false;
+	job = queue.jobs.front();
+	queue.jobs.pop_front();
+	return true;
+}
+
+// Try the other workers in turn, starting with the next one, and take the job their owner would run last
+bool WorkStealingPool::steal(int worker, int &job)
+{
+	for (int i = 1; i < num_workers; i++)
+	{
+		WorkerQueue &queue = *queues[(worker + i) % num_workers];
+		std::lock_guard<std::mutex> guard(queue.lock);
+		if (!queue.jobs.empty())
+		{
+			job = queue.jobs.back();
+			queue.jobs.pop_back();
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,264 @@
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "trace_parser.h"
+
+// Cursor over the buffer that keeps track of line and column for error messages
+class TraceScanner
+{
+	const char* pos;
+	const char* end;
+	const char* line_start;
+	const char* token_start;
+	int line;
+	ParseError &error;
+public:
+	TraceScanner(const char* data, size_t size, ParseError &err) : error(err)
+	{
+		pos = data;
+		end = data + size;
+		line_start = data;
+		token_start = data;
+		line = 1;
+	}
+
+	bool fail(const char* message)
+	{
+		error.line = line;
+		error.column = pos - line_start + 1;
+		error.message = message;
+		return false;
+	}
+
+	// Report an error at a position remembered earlier with getLine and getColumn
+	bool failAt(int at_line, int at_column, const std::string &message)
+	{
+		error.line = at_line;
+		error.column = at_column;
+		error.message = message;
+		return false;
+	}
+
+	int getLine() const
+	{
+		return line;
+	}
+
+	int getColumn() const
+	{
+		return pos - line_start + 1;
+	}
+
+	// Report an error at the start of the last integer read
+	bool failToken(const char* message)
+	{
+		pos = token_start;
+		return fail(message);
+	}
+
+	// Skip whitespace. Returns false at the end of the buffer
+	bool skipSpace()
+	{
+		while (pos < end)
+		{
+			char c = *pos;
+			if (c == '\n')
+			{
+				line++;
+				line_start = ++pos;
+			}
+			else if (c == ' ' || c == '\t' || c == '\r')
+			{
+				pos++;
+			}
+			else
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool readInt(int &value, const char* what)
+	{
+		if (!skipSpace())
+			return fail(what);
+
+		token_start = pos;
+		bool negative = false;
+		if (*pos == '-')
+		{
+			negative = true;
+			pos++;
+		}
+		if (pos == end || *pos < '0' || *pos > '9')
+			return fail(what);
+
+		long long result = 0;
+		while (pos < end && *pos >= '0' && *pos <= '9')
+		{
+			result = result * 10 + (*pos - '0');
+			if (result > 0x7fffffff)
+				return fail("integer out of range");
+			pos++;
+		}
+		if (pos < end && *pos != ' ' && *pos != '\t' && *pos != '\r' && *pos != '\n')
+			return fail(what);
+
+		value = negative ? -result : result;
+		return true;
+	}
+
+	// Keywords are dispatched on the first byte (the r of request and release is told apart by the third),
+	// then the rest of the word is checked in place
+	bool readActionType(action_t &type)
+	{
+		const char* word = pos;
+		const char* keyword = nullptr;
+		switch (*pos)
+		{
+		case 'i':
+			type = INITIATE;
+			keyword = "initiate";
+			break;
+		case 'r':
+			if (end - pos > 2 && pos[2] == 'q')
+			{
+				type = REQUEST;
+				keyword = "request";
+			}
+			else
+			{
+				type = RELEASE;
+				keyword = "release";
+			}
+			break;
+		case 't':
+			type = TERMINATE;
+			keyword = "terminate";
+			break;
+		default:
+			return fail("expected initiate, request, release or terminate");
+		}
+
+		size_t length = strlen(keyword);
+		if ((size_t)(end - word) < length || memcmp(word, keyword, length) != 0
+				|| (word + length < end && !isSpace(word[length])))
+			return fail("expected initiate, request, release or terminate");
+
+		pos += length;
+		return true;
+	}
+
+	bool isSpace(char c) const
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+	}
+};
+
+bool parseTraceBuffer(const char* data, size_t size, TraceInput &input, ParseError &error)
+{
+	TraceScanner scanner(data, size, error);
+
+	if (!scanner.readInt(input.num_tasks, "expected number of tasks"))
+		return false;
+	if (input.num_tasks < 0)
+		return scanner.fail("number of tasks can't be negative");
+	if (!scanner.readInt(input.num_resources, "expected number of resource types"))
+		return false;
+	if (input.num_resources < 0)
+		return scanner.fail("number of resource types can't be negative");
+
+	input.resources.assign(input.num_resources, 0);
+	for (int i = 0; i < input.num_resources; i++)
+	{
+		if (!scanner.readInt(input.resources[i], "expected units of resource"))
+			return false;
+	}
+
+	// A well-formed action line is at least 17 bytes, which makes a good guess for the reserve
+	input.actions.clear();
+	input.actions.reserve(size / 17);
+
+	// Where each task's last action starts, so a task that doesn't end with terminate can be pointed at
+	std::vector<int> last_line(input.num_tasks, 0), last_column(input.num_tasks, 0);
+	std::vector<action_t> last_type(input.num_tasks, TERMINATE);
+
+	action_t type;
+	int task_id = 0, delay = 0, resource_id = 0, amount = 0;
+	while (scanner.skipSpace())
+	{
+		int line = scanner.getLine();
+		int column = scanner.getColumn();
+		if (!scanner.readActionType(type) || !scanner.readInt(task_id, "expected task number"))
+			return false;
+		if (task_id < 1 || task_id > input.num_tasks)
+			return scanner.failToken("task number out of range");
+		if (!scanner.readInt(delay, "expected delay") || !scanner.readInt(resource_id, "expected resource type"))
+			return false;
+		if (type != TERMINATE && (resource_id < 1 || resource_id > input.num_resources))
+			return scanner.failToken("resource type out of range");
+		if (!scanner.readInt(amount, "expected number of units"))
+			return false;
+
+		input.actions.push_back(Action(type, task_id - 1, delay, resource_id - 1, amount));
+		last_line[task_id - 1] = line;
+		last_column[task_id - 1] = column;
+		last_type[task_id - 1] = type;
+	}
+
+	// A task runs until its terminate, so one without a terminate at the end would run out of actions
+	for (int i = 0; i < input.num_tasks; i++)
+	{
+		if (last_line[i] == 0)
+			return scanner.failAt(scanner.getLine(), scanner.getColumn(), "task " + std::to_string(i + 1)
+					+ " has no actions");
+		if (last_type[i] != TERMINATE)
+			return scanner.failAt(last_line[i], last_column[i], "task " + std::to_string(i + 1)
+					+ " doesn't end with terminate");
+	}
+	return true;
+}
+
+bool parseTraceFile(const std::string &filename, TraceInput &input, ParseError &error)
+{
+	error.line = 0;
+	error.column = 0;
+
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		error.message = "unable to open file";
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0)
+	{
+		close(fd);
+		error.message = "unable to read file";
+		return false;
+	}
+
+	size_t size = info.st_size;
+	if (size == 0)
+	{
+		close(fd);
+		return parseTraceBuffer("", 0, input, error);
+	}
+
+	void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+	{
+		error.message = "unable to map file";
+		return false;
+	}
+	madvise(data, size, MADV_SEQUENTIAL);
+
+	bool ok = parseTraceBuffer((const char*)data, size, input, error);
+	munmap(data, size);
+	return ok;
+}
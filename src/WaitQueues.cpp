@@ -0,0 +1,111 @@
+#include "data_types.h"
+#include <algorithm>
+#include <assert.h>
+#include <limits.h>
+
+// WaitQueues is one doubly-linked FIFO list per resource, threaded through arrays indexed by task id.
+// The minimum per list is only a lower bound: it is lowered on every push but not raised on removal,
+// so whoever walks a whole list can store the exact minimum back with setMinAmount
+
+WaitQueues::WaitQueues(int n_tasks, int n_resources)
+{
+	resize(n_tasks, n_resources);
+}
+
+// Empty every list and size the arrays for a different number of tasks and resources
+void WaitQueues::resize(int n_tasks, int n_resources)
+{
+	prev.assign(n_tasks, -1);
+	next.assign(n_tasks, -1);
+	resource_of.assign(n_tasks, -1);
+	head.assign(n_resources, -1);
+	tail.assign(n_resources, -1);
+	min_amount.assign(n_resources, INT_MAX);
+}
+
+// Sanity check for out of bounds array access
+bool WaitQueues::sanityCheck(int id) const
+{
+	return (id >= 0) && (id < (int)resource_of.size());
+}
+
+void WaitQueues::pushBack(int id, int resource_id, int amount)
+{
+	assert (sanityCheck(id));
+	assert (resource_of[id] < 0);
+	prev[id] = tail[resource_id];
+	next[id] = -1;
+	if (tail[resource_id] >= 0)
+	{
+		next[tail[resource_id]] = id;
+	}
+	else
+	{
+		head[resource_id] = id;
+	}
+	tail[resource_id] = id;
+	resource_of[id] = resource_id;
+	min_amount[resource_id] = std::min(min_amount[resource_id], amount);
+}
+
+void WaitQueues::remove(int id)
+{
+	assert (sanityCheck(id));
+	int resource_id = resource_of[id];
+	if (resource_id < 0)
+		return;
+
+	if (prev[id] >= 0)
+	{
+		next[prev[id]] = next[id];
+	}
+	else
+	{
+		head[resource_id] = next[id];
+	}
+	if (next[id] >= 0)
+	{
+		prev[next[id]] = prev[id];
+	}
+	else
+	{
+		tail[resource_id] = prev[id];
+	}
+	if (head[resource_id] < 0)
+	{
+		min_amount[resource_id] = INT_MAX;
+	}
+	prev[id] = -1;
+	next[id] = -1;
+	resource_of[id] = -1;
+}
+
+bool WaitQueues::contains(int id) const
+{
+	assert (sanityCheck(id));
+	return resource_of[id] >= 0;
+}
+
+// Returns -1 if nothing waits on the resource
+int WaitQueues::front(int resource_id) const
+{
+	return head[resource_id];
+}
+
+// Returns -1 if id is the last task waiting on its resource
+int WaitQueues::nextOf(int id) const
+{
+	assert (sanityCheck(id));
+	return next[id];
+}
+
+// INT_MAX if nothing waits on the resource
+int WaitQueues::getMinAmount(int resource_id) const
+{
+	return min_amount[resource_id];
+}
+
+void WaitQueues::setMinAmount(int resource_id, int amount)
+{
+	min_amount[resource_id] = amount;
+}
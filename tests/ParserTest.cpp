@@ -0,0 +1,160 @@
+// Inputs the text parser and the binary trace loaders must accept or reject, and where a rejection points.
+// Prints one line per case and exits with status 1 if any case fails.
+
+#include <fcntl.h>
+#include <iostream>
+#include <stdio.h>
+#include <string>
+#include <unistd.h>
+#include "binary_trace.h"
+#include "trace_parser.h"
+
+using namespace std;
+
+struct ParserCase
+{
+	const char* name;
+	const char* text;
+	bool accepted;
+	int line, column;				// where a rejected input's error points
+};
+
+static const ParserCase CASES[] =
+{
+	{ "well formed", "1 1 4\ninitiate 1 0 1 4\nrequest 1 0 1 2\nrelease 1 0 1 2\nterminate 1 0 0 0\n", true, 0, 0 },
+	{ "no terminate", "1 1 4\ninitiate 1 0 1 4\nrequest 1 0 1 2\n", false, 3, 1 },
+	{ "terminate not last", "1 1 4\ninitiate 1 0 1 4\nterminate 1 0 0 0\nrequest 1 0 1 2\n", false, 4, 1 },
+	{ "task without actions", "2 1 4\ninitiate 1 0 1 4\nterminate 1 0 0 0\n", false, 4, 1 },
+	{ "bad keyword", "1 1 4\nallocate 1 0 1 4\n", false, 2, 1 },
+	{ "task out of range", "1 1 4\ninitiate 2 0 1 4\n", false, 2, 10 },
+};
+
+static bool checkText(const ParserCase &test)
+{
+	TraceInput input;
+	ParseError error;
+	string text = test.text;
+	bool accepted = parseTraceBuffer(text.data(), text.size(), input, error);
+	bool ok = accepted == test.accepted && (accepted || (error.line == test.line && error.column == test.column));
+	cout << (ok ? "ok" : "FAILED") << "\ttext: " << test.name;
+	if (!accepted)
+		cout << " (" << error.line << ":" << error.column << ": " << error.message << ")";
+	cout << "\n";
+	return ok;
+}
+
+// The converter only writes inputs the parser accepted, so a trace without a terminate is written from a
+// TraceInput built by hand; both the mapped loader and the streaming reader have to refuse it
+static bool checkBinary()
+{
+	TraceInput input;
+	input.num_tasks = 1;
+	input.num_resources = 1;
+	input.resources.assign(1, 4);
+	input.actions.push_back(Action(INITIATE, 0, 0, 0, 4));
+	input.actions.push_back(Action(REQUEST, 0, 0, 0, 2));
+
+	char filename[] = "/tmp/parser_test_XXXXXX";
+	int fd = mkstemp(filename);
+	if (fd < 0)
+	{
+		cout << "FAILED\tbinary: no terminate (unable to create a temporary file)\n";
+		return false;
+	}
+	close(fd);
+
+	ParseError error;
+	bool ok = writeBinaryTrace(filename, input, error);
+	BinaryTrace trace;
+	bool mapped = trace.open(filename, error);
+	string mapped_message = error.message;
+	BinaryTraceReader reader;
+	bool streamed = reader.open(filename, 4, error);
+	unlink(filename);
+
+	ok = ok && !mapped && !streamed;
+	cout << (ok ? "ok" : "FAILED") << "\tbinary: no terminate (" << mapped_message << ")\n";
+	return ok;
+}
+
+struct BinaryCase
+{
+	const char* name;
+	int record, field;				// the 4-byte field of the record to overwrite: type, task, delay, resource, amount
+	int value;
+	bool accepted;
+};
+
+// Records of a converted "well formed" input: initiate, request, release, terminate of a single task
+static const BinaryCase BINARY_CASES[] =
+{
+	{ "well formed", 0, 2, 0, true },
+	{ "unknown action type", 1, 0, 7, false },
+	{ "record of another task", 1, 1, 1, false },
+	{ "resource out of range", 2, 3, 1, false },
+	{ "negative resource", 0, 3, -1, false },
+	{ "terminate with a resource", 3, 3, 0, false },
+};
+
+// Converts the well formed text case and overwrites one field of one record. The mapped loader has to refuse
+// a bad record on open; the streaming reader only reads the last record on open, so it may refuse the rest
+// when their window is read instead
+static bool checkBinaryRecord(const BinaryCase &test)
+{
+	TraceInput input;
+	ParseError error;
+	string text = CASES[0].text;
+	char filename[] = "/tmp/parser_test_XXXXXX";
+	int fd = mkstemp(filename);
+	if (fd < 0)
+	{
+		cout << "FAILED\tbinary: " << test.name << " (unable to create a temporary file)\n";
+		return false;
+	}
+	close(fd);
+
+	bool ok = parseTraceBuffer(text.data(), text.size(), input, error) && writeBinaryTrace(filename, input, error);
+	off_t records_start = sizeof(BinaryTraceHeader) + sizeof(int32_t) * (input.num_resources + input.num_tasks + 1);
+	int32_t value = test.value;
+	fd = open(filename, O_WRONLY);
+	ok = ok && fd >= 0 && pwrite(fd, &value, sizeof(value), records_start + sizeof(Action) * test.record
+			+ sizeof(int32_t) * test.field) == sizeof(value);
+	if (fd >= 0)
+	{
+		close(fd);
+	}
+
+	BinaryTrace trace;
+	bool accepted = trace.open(filename, error);
+	string message = error.message;
+	BinaryTraceReader reader;
+	bool streamed = reader.open(filename, 1, error);
+	if (streamed)
+	{
+		for (ActionStream stream = reader.getStream(0); !stream.exhausted(); stream.advance());
+		streamed = !reader.hasFailed();
+	}
+	unlink(filename);
+
+	ok = ok && accepted == test.accepted && streamed == test.accepted;
+	cout << (ok ? "ok" : "FAILED") << "\tbinary: " << test.name;
+	if (!accepted)
+		cout << " (" << message << ")";
+	cout << "\n";
+	return ok;
+}
+
+int main()
+{
+	bool ok = true;
+	for (unsigned int i = 0; i < sizeof(CASES) / sizeof(CASES[0]); i++)
+	{
+		ok = checkText(CASES[i]) && ok;
+	}
+	ok = checkBinary() && ok;
+	for (unsigned int i = 0; i < sizeof(BINARY_CASES) / sizeof(BINARY_CASES[0]); i++)
+	{
+		ok = checkBinaryRecord(BINARY_CASES[i]) && ok;
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,390 @@
+// Seeded generator of synthetic workloads for scale testing. Writes a valid input file (or a binary trace)
+// with a given number of tasks and resource types, claim and delay distributions, contention level and a
+// rate of tasks that deliberately take part in a deadlock. The same options and seed always give the same file.
+// Tasks are generated and written one at a time, so 10^7-task workloads don't need to fit in memory.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "binary_trace.h"
+#include "data_types.h"
+
+using namespace std;
+
+enum claim_dist_t { CLAIMS_UNIFORM, CLAIMS_HOT };
+enum delay_dist_t { DELAY_NONE, DELAY_UNIFORM, DELAY_EXP };
+
+struct GenOptions
+{
+	long long tasks;
+	int resources;
+	int units_low, units_high;
+	claim_dist_t claims;
+	delay_dist_t delays;
+	int delay_param;		// max delay (uniform) or mean delay (exp)
+	double contention;		// claims are drawn from [0, contention * units]
+	double deadlock_rate;	// fraction of tasks that grab two whole resources in opposite orders
+	int steps;				// request/release actions per task, at most
+	uint64_t seed;
+	bool binary;
+	string output;
+};
+
+// splitmix64: a fixed generator, so output doesn't depend on the standard library's distributions
+class Rng
+{
+	uint64_t state;
+public:
+	Rng(uint64_t seed) : state(seed) {}
+	uint64_t next()
+	{
+		uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return z ^ (z >> 31);
+	}
+	// Uniform in [low, high]
+	int range(int low, int high)
+	{
+		return low + (int)(next() % (uint64_t)(high - low + 1));
+	}
+	// Uniform in [0, 1)
+	double unit()
+	{
+		return (next() >> 11) * (1.0 / 9007199254740992.0);
+	}
+};
+
+// Writes actions as text lines or binary records. For a binary trace the records are written straight after
+// room for the offsets, which are filled in at the end along with the action count
+class WorkloadWriter
+{
+	FILE* file;
+	bool binary;
+	int num_resources;
+	long long num_tasks, num_actions;
+	vector<int32_t> offsets;
+	char line[96];
+public:
+	WorkloadWriter() : file(nullptr), binary(false), num_resources(0), num_tasks(0), num_actions(0) {}
+
+	bool open(const GenOptions &options, const vector<int> &units)
+	{
+		binary = options.binary;
+		num_tasks = options.tasks;
+		num_resources = options.resources;
+		file = options.output.empty() ? stdout : fopen(options.output.c_str(), binary ? "wb" : "w");
+		if (!file)
+			return false;
+
+		if (!binary)
+		{
+			fprintf(file, "%lld %d", num_tasks, num_resources);
+			for (int i = 0; i < num_resources; i++)
+			{
+				fprintf(file, " %d", units[i]);
+			}
+			fputc('\n', file);
+			return true;
+		}
+
+		BinaryTraceHeader header;
+		memset(&header, 0, sizeof(header));
+		offsets.assign(num_tasks + 1, 0);
+		bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+		ok = ok && fwrite(units.data(), sizeof(int32_t), num_resources, file) == (size_t)num_resources;
+		ok = ok && fwrite(offsets.data(), sizeof(int32_t), offsets.size(), file) == offsets.size();
+		return ok;
+	}
+
+	// Ids are 0-based here, as in the binary format; the text format is 1-based. A terminate's resource id is -1
+	void write(action_t type, int task_id, int delay, int resource_id, int amount)
+	{
+		num_actions++;
+		if (binary)
+		{
+			int32_t record[5] = { (int32_t)type, task_id, delay, resource_id, amount };
+			fwrite(record, sizeof(record), 1, file);
+			offsets[task_id + 1] = (int32_t)num_actions;
+			return;
+		}
+		static const char* names[] = { "initiate", "request", "release", "terminate" };
+		int length = snprintf(line, sizeof(line), "%s %d %d %d %d\n", names[type], task_id + 1, delay,
+				resource_id + 1, amount);
+		fwrite(line, 1, length, file);
+	}
+
+	bool close()
+	{
+		bool ok = !ferror(file);
+		if (binary && ok)
+		{
+			BinaryTraceHeader header;
+			memset(&header, 0, sizeof(header));
+			memcpy(header.magic, BINARY_TRACE_MAGIC, sizeof(header.magic));
+			header.version = BINARY_TRACE_VERSION;
+			header.byte_order = BINARY_TRACE_BYTE_ORDER;
+			header.record_size = sizeof(Action);
+			header.num_tasks = (int32_t)num_tasks;
+			header.num_resources = num_resources;
+			header.num_actions = (int32_t)num_actions;
+			ok = fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+			ok = ok && fseek(file, sizeof(header) + num_resources * sizeof(int32_t), SEEK_SET) == 0;
+			ok = ok && fwrite(offsets.data(), sizeof(int32_t), offsets.size(), file) == offsets.size();
+		}
+		if (file != stdout)
+		{
+			ok = (fclose(file) == 0) && ok;
+		}
+		else
+		{
+			ok = (fflush(file) == 0) && ok;
+		}
+		return ok;
+	}
+
+	long long getNumActions() const
+	{
+		return num_actions;
+	}
+};
+
+static int drawDelay(const GenOptions &options, Rng &rng)
+{
+	switch (options.delays)
+	{
+	case DELAY_UNIFORM:
+		return rng.range(0, options.delay_param);
+	case DELAY_EXP:
+	{
+		// Geometric, the discrete counterpart of an exponential with this mean
+		double p = 1.0 / (options.delay_param + 1);
+		int delay = 0;
+		while (rng.unit() >= p && delay < 100 * options.delay_param)
+		{
+			delay++;
+		}
+		return delay;
+	}
+	default:
+		return 0;
+	}
+}
+
+// With hot claims, resource i is picked about twice as often as resource i + 1, so the low ids are contended
+static int pickResource(const GenOptions &options, Rng &rng)
+{
+	if (options.claims == CLAIMS_UNIFORM)
+		return rng.range(0, options.resources - 1);
+
+	int resource_id = 0;
+	while (resource_id < options.resources - 1 && rng.unit() < 0.5)
+	{
+		resource_id++;
+	}
+	return resource_id;
+}
+
+// A task that claims and takes all of two resources, in an order that depends on its parity. Two such tasks
+// of opposite parity that each get their first resource deadlock the optimistic manager
+static void generateDeadlockTask(const GenOptions &options, const vector<int> &units, int id, Rng &rng,
+		WorkloadWriter &writer)
+{
+	int first = rng.range(0, options.resources - 1);
+	int second = (first + 1) % options.resources;
+	if (id % 2 == 1)
+	{
+		swap(first, second);
+	}
+	for (int i = 0; i < options.resources; i++)
+	{
+		writer.write(INITIATE, id, 0, i, (i == first || i == second) ? units[i] : 0);
+	}
+	writer.write(REQUEST, id, drawDelay(options, rng), first, units[first]);
+	writer.write(REQUEST, id, 1 + drawDelay(options, rng), second, units[second]);
+	writer.write(RELEASE, id, drawDelay(options, rng), first, units[first]);
+	writer.write(RELEASE, id, 0, second, units[second]);
+	writer.write(TERMINATE, id, drawDelay(options, rng), -1, 0);
+}
+
+// Claim some of each resource, then request and release within the claims, release what's left and terminate.
+// Every resource type is initiated, even with a claim of 0, so that every task's initiates are done before any
+// task's first request and the banker checks each claim against the full units
+static void generateTask(const GenOptions &options, const vector<int> &units, int id, Rng &rng,
+		vector<int> &claims, vector<int> &held, WorkloadWriter &writer)
+{
+	for (int i = 0; i < options.resources; i++)
+	{
+		int most = (int)(options.contention * units[i] + 0.5);
+		claims[i] = rng.range(0, min(most, units[i]));
+		held[i] = 0;
+		writer.write(INITIATE, id, 0, i, claims[i]);
+	}
+
+	int steps = rng.range(1, options.steps);
+	for (int step = 0; step < steps; step++)
+	{
+		int resource_id = pickResource(options, rng);
+		if (claims[resource_id] > held[resource_id] && (held[resource_id] == 0 || rng.unit() < 0.6))
+		{
+			int amount = rng.range(1, claims[resource_id] - held[resource_id]);
+			held[resource_id] += amount;
+			writer.write(REQUEST, id, drawDelay(options, rng), resource_id, amount);
+		}
+		else if (held[resource_id] > 0)
+		{
+			int amount = rng.range(1, held[resource_id]);
+			held[resource_id] -= amount;
+			writer.write(RELEASE, id, drawDelay(options, rng), resource_id, amount);
+		}
+	}
+	for (int i = 0; i < options.resources; i++)
+	{
+		if (held[i] > 0)
+		{
+			writer.write(RELEASE, id, drawDelay(options, rng), i, held[i]);
+		}
+	}
+	writer.write(TERMINATE, id, drawDelay(options, rng), -1, 0);
+}
+
+static bool parseRange(const string &value, int &low, int &high)
+{
+	if (sscanf(value.c_str(), "%d:%d", &low, &high) == 2)
+		return low >= 1 && low <= high;
+	low = high = atoi(value.c_str());
+	return low >= 1;
+}
+
+static bool parseDelays(const string &value, GenOptions &options)
+{
+	options.delay_param = 0;
+	if (value == "none")
+	{
+		options.delays = DELAY_NONE;
+		return true;
+	}
+	if (value.compare(0, 8, "uniform:") == 0)
+	{
+		options.delays = DELAY_UNIFORM;
+		options.delay_param = atoi(value.c_str() + 8);
+	}
+	else if (value.compare(0, 4, "exp:") == 0)
+	{
+		options.delays = DELAY_EXP;
+		options.delay_param = atoi(value.c_str() + 4);
+	}
+	else
+	{
+		return false;
+	}
+	return options.delay_param > 0;
+}
+
+static void printUsage(const char* program)
+{
+	cerr << "Usage: " << program << " [options] [output-file]\n"
+			"  --tasks=N             number of tasks (default 1000)\n"
+			"  --resources=N         number of resource types (default 4)\n"
+			"  --units=N|LOW:HIGH    units of each resource type, drawn uniformly (default 4:16)\n"
+			"  --claims=uniform|hot  which resources tasks use; hot favours the low ids (default uniform)\n"
+			"  --delays=none|uniform:MAX|exp:MEAN  compute delay per action (default uniform:2)\n"
+			"  --contention=F        claims are drawn from 0 to F times a resource's units, 0 < F <= 1 (default 0.5)\n"
+			"  --deadlock-rate=F     fraction of tasks that take two whole resources in opposite orders (default 0)\n"
+			"  --steps=N             request/release actions per task, at most (default 6)\n"
+			"  --seed=N              random seed (default 1)\n"
+			"  --binary              write a binary trace instead of a text input file (needs an output file)\n"
+			"Text goes to stdout when no output file is given.\n";
+}
+
+int main(int argc, char** argv)
+{
+	GenOptions options;
+	options.tasks = 1000;
+	options.resources = 4;
+	options.units_low = 4;
+	options.units_high = 16;
+	options.claims = CLAIMS_UNIFORM;
+	options.delays = DELAY_UNIFORM;
+	options.delay_param = 2;
+	options.contention = 0.5;
+	options.deadlock_rate = 0;
+	options.steps = 6;
+	options.seed = 1;
+	options.binary = false;
+
+	bool ok = true;
+	for (int i = 1; i < argc && ok; i++)
+	{
+		string arg = argv[i];
+		size_t equals = arg.find('=');
+		string key = arg.substr(0, equals);
+		string value = equals == string::npos ? "" : arg.substr(equals + 1);
+		if (key == "--tasks")
+			ok = (options.tasks = atoll(value.c_str())) >= 1 && options.tasks < INT32_MAX;
+		else if (key == "--resources")
+			ok = (options.resources = atoi(value.c_str())) >= 1;
+		else if (key == "--units")
+			ok = parseRange(value, options.units_low, options.units_high);
+		else if (key == "--claims")
+		{
+			options.claims = value == "hot" ? CLAIMS_HOT : CLAIMS_UNIFORM;
+			ok = value == "hot" || value == "uniform";
+		}
+		else if (key == "--delays")
+			ok = parseDelays(value, options);
+		else if (key == "--contention")
+			ok = (options.contention = atof(value.c_str())) > 0 && options.contention <= 1;
+		else if (key == "--deadlock-rate")
+			ok = (options.deadlock_rate = atof(value.c_str())) >= 0 && options.deadlock_rate <= 1;
+		else if (key == "--steps")
+			ok = (options.steps = atoi(value.c_str())) >= 1;
+		else if (key == "--seed")
+			options.seed = strtoull(value.c_str(), nullptr, 10);
+		else if (key == "--binary")
+			options.binary = true;
+		else if (arg.compare(0, 2, "--") != 0 && options.output.empty())
+			options.output = arg;
+		else
+			ok = false;
+	}
+	if (!ok || (options.binary && options.output.empty()))
+	{
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	Rng rng(options.seed);
+	vector<int> units(options.resources);
+	for (int i = 0; i < options.resources; i++)
+	{
+		units[i] = rng.range(options.units_low, options.units_high);
+	}
+
+	WorkloadWriter writer;
+	if (!writer.open(options, units))
+	{
+		cerr << "Unable to open " << options.output << " for writing\n";
+		return 1;
+	}
+
+	vector<int> claims(options.resources), held(options.resources);
+	for (int id = 0; id < options.tasks; id++)
+	{
+		if (options.resources > 1 && rng.unit() < options.deadlock_rate)
+			generateDeadlockTask(options, units, id, rng, writer);
+		else
+			generateTask(options, units, id, rng, claims, held, writer);
+	}
+
+	if (!writer.close() || writer.getNumActions() > INT32_MAX)
+	{
+		cerr << "Unable to write " << (options.output.empty() ? "stdout" : options.output) << "\n";
+		return 1;
+	}
+	return 0;
+}